@@ -8,6 +8,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "clock.h"
+
 static char buffer_middle_man[512] = {};
 static char buffer[512] = {};
 static int buffer_index = 0;
@@ -66,15 +68,20 @@ char *rtc_client_setup() {
         ESP_LOGE("RTC", "The value is NULL");
         return (0);
     } else {
+        // fallback source, never overrides SNTP
+        cJSON *unixtime = cJSON_GetObjectItem(time_buffer, "unixtime");
+        if (cJSON_IsNumber(unixtime) && clock_source() < CLOCK_SOURCE_HTTP) {
+            clock_set_utc((int64_t)unixtime->valuedouble * 1000000, CLOCK_SOURCE_HTTP);
+        }
         cJSON *datetime = cJSON_GetObjectItem(time_buffer, "datetime");
-        if (datetime && cJSON_IsString(datetime)) {
+        bool have_datetime = datetime && cJSON_IsString(datetime);
+        if (have_datetime) {
             ESP_LOGI("TIME", " %s\n\n", datetime->valuestring);
             snprintf(rtc_time, 20, "%s", datetime->valuestring);
-            if (time_buffer) {
-                cJSON_Delete(time_buffer);
-            }
-            return (rtc_time);
         }
-        return 0;
+        // rtc_time holds a copy, the tree goes on every path
+        cJSON_Delete(time_buffer);
+        time_buffer = NULL;
+        return have_datetime ? rtc_time : 0;
     }
 }
@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+#include "clock.h"
+
+#define TAG "CLOCK"
+
+// The offset is 64 bits and the cores are 32 bits wide, so it is guarded by a
+// sequence counter: readers retry on the rare occasion a steer raced them.
+static portMUX_TYPE steer_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t seq = 0;
+static int64_t offset_us = 0;
+static clock_source_t source = CLOCK_SOURCE_NONE;
+static clock_sync_cb_t sync_cb = NULL;
+
+void clock_init() {
+    setenv("TZ", CONFIG_CLOCK_TZ, 1);
+    tzset();
+}
+
+int64_t clock_offset_us() {
+    uint32_t start;
+    int64_t offset;
+    do {
+        while ((start = __atomic_load_n(&seq, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        offset = offset_us;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (start != __atomic_load_n(&seq, __ATOMIC_RELAXED));
+    return offset;
+}
+
+void clock_set_utc(int64_t utc_us, clock_source_t src) {
+    int64_t mono_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&steer_lock);
+    __atomic_store_n(&seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    offset_us = utc_us - mono_us;
+    source = src;
+    __atomic_store_n(&seq, seq + 1, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&steer_lock);
+
+    // SNTP already set the system time itself
+    if (src != CLOCK_SOURCE_SNTP) {
+        struct timeval tv = {.tv_sec = utc_us / 1000000, .tv_usec = utc_us % 1000000};
+        settimeofday(&tv, NULL);
+    }
+    ESP_LOGI(TAG, "set from source %d", src);
+    if (sync_cb)
+        sync_cb(utc_us, src);
+}
+
+void clock_on_sync(clock_sync_cb_t cb) { sync_cb = cb; }
+
+bool clock_is_set() { return source != CLOCK_SOURCE_NONE; }
+
+clock_source_t clock_source() { return source; }
+
+void clock_local_tm(int64_t utc_us, struct tm *out) {
+    time_t secs = utc_us / 1000000;
+    localtime_r(&secs, out);
+}
+
+size_t clock_format_local(int64_t utc_us, const char *fmt, char *buf, size_t len) {
+    struct tm tm;
+    clock_local_tm(utc_us, &tm);
+    return strftime(buf, len, fmt, &tm);
+}
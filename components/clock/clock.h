@@ -0,0 +1,39 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "esp_timer.h"
+
+typedef enum {
+    CLOCK_SOURCE_NONE,
+    CLOCK_SOURCE_RTC,
+    CLOCK_SOURCE_HTTP,
+    CLOCK_SOURCE_SNTP,
+} clock_source_t;
+
+typedef void (*clock_sync_cb_t)(int64_t utc_us, clock_source_t source);
+
+void clock_init();
+// steer the clock: offset = utc - monotonic, also updates the libc time
+void clock_set_utc(int64_t utc_us, clock_source_t source);
+// called after every clock_set_utc, one listener (the RTC keeps itself in step)
+void clock_on_sync(clock_sync_cb_t cb);
+bool clock_is_set();
+clock_source_t clock_source();
+
+// offset between the monotonic base and UTC, consistent even while it is being steered
+int64_t clock_offset_us();
+
+// timestamps are taken on the monotonic base and turned into UTC with one add
+static inline int64_t clock_mono_us() { return esp_timer_get_time(); }
+static inline int64_t clock_utc_us(int64_t mono_us) { return mono_us + clock_offset_us(); }
+static inline int64_t clock_now_us() { return clock_utc_us(clock_mono_us()); }
+
+// presentation only: local time in CONFIG_CLOCK_TZ
+void clock_local_tm(int64_t utc_us, struct tm *out);
+size_t clock_format_local(int64_t utc_us, const char *fmt, char *buf, size_t len);
+
+#endif
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_cpu.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "dlog.h"
+#include "tasks.h"
+
+#define TAG "DLOG"
+
+#define RING_LEN CONFIG_DLOG_RING_LEN
+#define DRAIN_MS 50
+#define MAX_TAGS 16
+#define LINE_MAX 160
+
+_Static_assert((RING_LEN & (RING_LEN - 1)) == 0, "CONFIG_DLOG_RING_LEN must be a power of two");
+
+// Bounded multi-producer ring: a writer claims a position by moving head,
+// and a slot is free for position pos while its seq equals pos. Once filled
+// seq becomes pos + 1, and the drain hands it back as pos + RING_LEN.
+typedef struct {
+    uint32_t seq;
+    uint8_t level;
+    uint8_t nargs;
+    uint32_t ms;
+    const char *tag;
+    const char *fmt;
+    dlog_word_t args[DLOG_MAX_ARGS];
+} record_t;
+
+static record_t ring[RING_LEN];
+static uint32_t head;
+static uint32_t tail;  // drain task only
+static uint32_t dropped;
+
+// per tag rate limit, drain task only
+static struct {
+    const char *tag;
+    uint32_t window_ms;
+    uint32_t lines;
+    uint32_t suppressed;
+} tags[MAX_TAGS];
+
+void IRAM_ATTR dlog_write(esp_log_level_t level, const char *tag, const char *fmt, uint8_t nargs, const dlog_word_t *args) {
+    uint32_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    record_t *r;
+    while (1) {
+        r = &ring[pos & (RING_LEN - 1)];
+        int32_t diff = (int32_t)(__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            // the drain hasn't freed this slot yet: full
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        }
+    }
+    r->level = level;
+    r->nargs = nargs > DLOG_MAX_ARGS ? DLOG_MAX_ARGS : nargs;
+    r->ms = esp_timer_get_time() / 1000;
+    r->tag = tag;
+    r->fmt = fmt;
+    for (uint8_t i = 0; i < r->nargs; i++)
+        r->args[i] = args[i];
+    __atomic_store_n(&r->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t dlog_dropped() { return __atomic_load_n(&dropped, __ATOMIC_RELAXED); }
+
+// printf with arguments whose types are only known from the format string
+static void format(char *out, size_t size, const char *fmt, const dlog_word_t *args, uint8_t nargs) {
+    size_t len = 0;
+    uint8_t next = 0;
+    while (*fmt && len < size - 1) {
+        if (*fmt != '%') {
+            out[len++] = *fmt++;
+            continue;
+        }
+        // copy one conversion spec, length modifiers dropped
+        char spec[16] = "%";
+        size_t n = 1;
+        const char *p = fmt + 1;
+        while (*p && strchr("-+ #0123456789.", *p) && n < sizeof(spec) - 3)
+            spec[n++] = *p++;
+        while (*p && strchr("hlzjt", *p))
+            p++;
+        char conv = *p ? *p++ : '%';
+        spec[n++] = conv;
+        spec[n] = '\0';
+        fmt = p;
+
+        dlog_word_t arg = next < nargs ? args[next] : 0;
+        size_t room = size - len;
+        int w;
+        if (conv == '%') {
+            w = snprintf(out + len, room, "%%");
+        } else if (next >= nargs) {
+            w = snprintf(out + len, room, "<?>");
+        } else if (strchr("feEgGF", conv)) {
+            union {
+                uint32_t u;
+                float f;
+            } bits = {.u = (uint32_t)arg};
+            w = snprintf(out + len, room, spec, (double)bits.f);
+            next++;
+        } else if (conv == 's') {
+            w = snprintf(out + len, room, spec, arg ? (const char *)arg : "(null)");
+            next++;
+        } else if (conv == 'p') {
+            w = snprintf(out + len, room, spec, (void *)arg);
+            next++;
+        } else if (strchr("di", conv)) {
+            w = snprintf(out + len, room, spec, (int)(int32_t)arg);
+            next++;
+        } else {
+            w = snprintf(out + len, room, spec, (unsigned)(uint32_t)arg);
+            next++;
+        }
+        if (w > 0)
+            len += (size_t)w < room ? (size_t)w : room - 1;
+    }
+    out[len] = '\0';
+}
+
+static bool rate_ok(const char *tag, uint32_t now_ms) {
+    int slot = -1;
+    for (int i = 0; i < MAX_TAGS; i++) {
+        if (tags[i].tag == tag) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 && tags[i].tag == NULL)
+            slot = i;
+    }
+    // more tags than slots go unlimited
+    if (slot < 0)
+        return true;
+    if (tags[slot].tag != tag) {
+        tags[slot].tag = tag;
+        tags[slot].window_ms = now_ms;
+    }
+    if (now_ms - tags[slot].window_ms >= 1000) {
+        if (tags[slot].suppressed)
+            esp_log_write(ESP_LOG_WARN, tag, "W (%lu) %s: %lu lines suppressed\n", (unsigned long)now_ms, tag, (unsigned long)tags[slot].suppressed);
+        tags[slot].window_ms = now_ms;
+        tags[slot].lines = 0;
+        tags[slot].suppressed = 0;
+    }
+    if (tags[slot].lines >= CONFIG_DLOG_TAG_RATE) {
+        tags[slot].suppressed++;
+        return false;
+    }
+    tags[slot].lines++;
+    return true;
+}
+
+static void drain(void *arg) {
+    static const char letters[] = "NEWIDV";
+    char line[LINE_MAX];
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(DRAIN_MS));
+        while (1) {
+            record_t *r = &ring[tail & (RING_LEN - 1)];
+            if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != tail + 1)
+                break;
+            record_t rec = *r;
+            __atomic_store_n(&r->seq, tail + RING_LEN, __ATOMIC_RELEASE);
+            tail++;
+
+            if (!rate_ok(rec.tag, rec.ms))
+                continue;
+            format(line, sizeof(line), rec.fmt, rec.args, rec.nargs);
+            esp_log_write(rec.level, rec.tag, "%c (%lu) %s: %s\n", letters[rec.level < 6 ? rec.level : 0], (unsigned long)rec.ms, rec.tag, line);
+        }
+    }
+}
+
+void dlog_init() {
+    for (uint32_t i = 0; i < RING_LEN; i++)
+        ring[i].seq = i;
+    tasks_start(TASK_DLOG, drain, NULL);
+}
+
+void dlog_bench(uint32_t n) {
+    if (n > RING_LEN)
+        n = RING_LEN;
+    // let the drain empty the ring first, a full ring would measure the drop path
+    vTaskDelay(pdMS_TO_TICKS(2 * DRAIN_MS));
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < n; i++)
+        DLOGI("BENCH", "dlog %lu %.1f", (unsigned long)i, 21.5f);
+    uint32_t dlog_cycles = esp_cpu_get_cycle_count() - start;
+
+    start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < n; i++)
+        ESP_LOGI("BENCH", "esp_log %lu %.1f", (unsigned long)i, 21.5f);
+    uint32_t esp_log_cycles = esp_cpu_get_cycle_count() - start;
+
+    ESP_LOGI(TAG, "cycles per call over %lu calls: DLOGI %lu, ESP_LOGI %lu", (unsigned long)n, (unsigned long)(dlog_cycles / n),
+             (unsigned long)(esp_log_cycles / n));
+}
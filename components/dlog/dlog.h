@@ -0,0 +1,57 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include "esp_log.h"
+
+// Deferred logging for hot paths and ISRs: a call stores the format string
+// pointer and up to DLOG_MAX_ARGS raw arguments in a lock-free ring, the
+// formatting and the UART happen later in a low priority drain task.
+//
+// The format string, the tag and every %s argument must outlive the call
+// (literals, static names). Integers up to 32 bits, floats, chars, %s and %p
+// are supported; no 64-bit arguments.
+#define DLOG_MAX_ARGS 4
+
+typedef uintptr_t dlog_word_t;
+
+void dlog_init();
+void dlog_write(esp_log_level_t level, const char *tag, const char *fmt, uint8_t nargs, const dlog_word_t *args);
+// records lost to a full ring since boot
+uint32_t dlog_dropped();
+// logs the cycles per call of DLOGI and ESP_LOGI, n calls each
+void dlog_bench(uint32_t n);
+
+static inline dlog_word_t dlog_from_int(uintptr_t v) { return v; }
+static inline dlog_word_t dlog_from_ptr(const void *v) { return (uintptr_t)v; }
+static inline dlog_word_t dlog_from_float(double v) {
+    union {
+        float f;
+        uint32_t u;
+    } bits = {.f = (float)v};
+    return bits.u;
+}
+
+#define DLOG_ARG(x)                                                                                                                                            \
+    _Generic((x), float: dlog_from_float, double: dlog_from_float, char *: dlog_from_ptr, const char *: dlog_from_ptr, void *: dlog_from_ptr,                  \
+             const void *: dlog_from_ptr, default: dlog_from_int)(x)
+
+#define DLOG_N(...) DLOG_N_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define DLOG_N_(_0, _1, _2, _3, _4, n, ...) n
+#define DLOG_A0()
+#define DLOG_A1(a) DLOG_ARG(a)
+#define DLOG_A2(a, b) DLOG_ARG(a), DLOG_ARG(b)
+#define DLOG_A3(a, b, c) DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c)
+#define DLOG_A4(a, b, c, d) DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d)
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b) a##b
+
+#define DLOG(level, tag, fmt, ...)                                                                                                                             \
+    dlog_write(level, tag, fmt, DLOG_N(__VA_ARGS__), (const dlog_word_t[]){0, DLOG_CAT(DLOG_A, DLOG_N(__VA_ARGS__))(__VA_ARGS__)} + 1)
+
+#define DLOGE(tag, fmt, ...) DLOG(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+
+#endif
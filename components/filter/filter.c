@@ -0,0 +1,100 @@
+#include <string.h>
+
+#include "filter.h"
+
+static void prime(filter_stage_t *s, fix_t x) {
+    switch (s->conf.kind) {
+    case FILTER_MEDIAN:
+        for (uint8_t i = 0; i < s->conf.window; i++)
+            s->median.ring[i] = s->median.sorted[i] = x;
+        s->median.next = 0;
+        break;
+    case FILTER_EMA:
+        s->ema = x;
+        break;
+    case FILTER_KALMAN:
+        s->kalman.x = x;
+        s->kalman.p = s->conf.kalman.r;
+        break;
+    }
+}
+
+// The sorted copy is kept up to date by moving the one slot that changes,
+// at most window - 1 shifts, so there is no sort per sample.
+static fix_t median_step(filter_stage_t *s, fix_t x) {
+    uint8_t n = s->conf.window;
+    fix_t *sorted = s->median.sorted;
+    fix_t old = s->median.ring[s->median.next];
+    s->median.ring[s->median.next] = x;
+    s->median.next = s->median.next + 1 == n ? 0 : s->median.next + 1;
+
+    uint8_t i = 0;
+    while (sorted[i] != old)
+        i++;
+    while (i > 0 && sorted[i - 1] > x) {
+        sorted[i] = sorted[i - 1];
+        i--;
+    }
+    while (i + 1 < n && sorted[i + 1] < x) {
+        sorted[i] = sorted[i + 1];
+        i++;
+    }
+    sorted[i] = x;
+    return sorted[n / 2];
+}
+
+// the half-step bias rounds to nearest, a plain shift would always round
+// down and settle up to one step below a constant input
+static fix_t ema_step(filter_stage_t *s, fix_t x) {
+    fix_t half = s->conf.shift ? 1 << (s->conf.shift - 1) : 0;
+    s->ema += (x - s->ema + half) >> s->conf.shift;
+    return s->ema;
+}
+
+// p, q and r are Q16.16 variances, the gain k is Q16 in [0, 1)
+static fix_t kalman_step(filter_stage_t *s, fix_t z) {
+    int64_t p = (int64_t)s->kalman.p + s->conf.kalman.q;
+    int64_t k = (p << 16) / (p + s->conf.kalman.r);
+    s->kalman.x += (fix_t)(((int64_t)(z - s->kalman.x) * k) >> 16);
+    s->kalman.p = (fix_t)((p * (FIX_ONE - k)) >> 16);
+    return s->kalman.x;
+}
+
+void filter_chain_init(filter_chain_t *chain, const filter_conf_t *conf, size_t count) {
+    memset(chain, 0, sizeof(*chain));
+    for (size_t i = 0; i < count && chain->count < FILTER_MAX_STAGES; i++) {
+        filter_stage_t *s = &chain->stage[chain->count];
+        s->conf = conf[i];
+        if (s->conf.kind == FILTER_MEDIAN && s->conf.window > FILTER_MEDIAN_MAX)
+            s->conf.window = FILTER_MEDIAN_MAX;
+        if (s->conf.kind == FILTER_KALMAN && s->conf.kalman.r <= 0)
+            s->conf.kalman.r = 1;
+        // a window of 1 or a shift of 0 would be a no-op stage
+        if ((s->conf.kind == FILTER_MEDIAN && s->conf.window <= 1) || (s->conf.kind == FILTER_EMA && s->conf.shift == 0))
+            continue;
+        chain->count++;
+    }
+}
+
+fix_t filter_chain_step(filter_chain_t *chain, fix_t x) {
+    for (uint8_t i = 0; i < chain->count; i++) {
+        filter_stage_t *s = &chain->stage[i];
+        if (!chain->primed) {
+            prime(s, x);
+            continue;
+        }
+        switch (s->conf.kind) {
+        case FILTER_MEDIAN:
+            x = median_step(s, x);
+            break;
+        case FILTER_EMA:
+            x = ema_step(s, x);
+            break;
+        case FILTER_KALMAN:
+            x = kalman_step(s, x);
+            break;
+        }
+    }
+    chain->primed = 1;
+    return x;
+}
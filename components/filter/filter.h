@@ -0,0 +1,65 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Signal conditioning for one channel: a short chain of filters run on every
+// sample in a fixed amount of integer work, no FPU and no heap. Samples are
+// Q16.16 fixed point; the first sample primes every stage with itself.
+
+typedef int32_t fix_t;
+#define FIX_ONE (1 << 16)
+#define FIX_FROM_INT(i) ((fix_t)(i) * FIX_ONE)
+// for configuration and publishing only, never on the per-sample path
+#define FIX_FROM_FLOAT(f) ((fix_t)((f) * FIX_ONE + ((f) < 0 ? -0.5f : 0.5f)))
+#define FIX_TO_FLOAT(x) ((float)(x) / FIX_ONE)
+
+#define FILTER_MAX_STAGES 3
+#define FILTER_MEDIAN_MAX 7
+
+typedef enum {
+    FILTER_MEDIAN,  // spike rejection over the last window samples
+    FILTER_EMA,     // y += (x - y) / 2^shift
+    FILTER_KALMAN,  // 1-D random walk, q and r are variances in units^2
+} filter_kind_t;
+
+typedef struct {
+    filter_kind_t kind;
+    union {
+        uint8_t window;  // median, 1..FILTER_MEDIAN_MAX
+        uint8_t shift;   // ema, 1..15
+        struct {
+            fix_t q;  // process noise per sample
+            fix_t r;  // measurement noise
+        } kalman;
+    };
+} filter_conf_t;
+
+typedef struct {
+    filter_conf_t conf;
+    union {
+        struct {
+            fix_t ring[FILTER_MEDIAN_MAX];  // arrival order
+            fix_t sorted[FILTER_MEDIAN_MAX];
+            uint8_t next;
+        } median;
+        fix_t ema;
+        struct {
+            fix_t x;
+            fix_t p;
+        } kalman;
+    };
+} filter_stage_t;
+
+typedef struct {
+    uint8_t count;
+    uint8_t primed;
+    filter_stage_t stage[FILTER_MAX_STAGES];
+} filter_chain_t;
+
+// stages past FILTER_MAX_STAGES are ignored, an empty chain passes samples through
+void filter_chain_init(filter_chain_t *chain, const filter_conf_t *conf, size_t count);
+fix_t filter_chain_step(filter_chain_t *chain, fix_t x);
+
+#endif
@@ -0,0 +1,200 @@
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_cpu.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+#include <esp_debug_helpers.h>
+#endif
+
+#include "heapacct.h"
+#include "tasks.h"
+
+#define TAG "HEAPACCT"
+
+#define MAP_LEN CONFIG_HEAPACCT_MAP_LEN
+// a quarter of the map stays free, so every probe chain ends at a hole soon
+#define MAP_LOAD_MAX (MAP_LEN / 4 * 3)
+#define ISR_SLOT 0
+#define BOOT_SLOT 1
+// tasks that show up after the table is full
+#define OTHER_SLOT 2
+
+_Static_assert((MAP_LEN & (MAP_LEN - 1)) == 0, "CONFIG_HEAPACCT_MAP_LEN must be a power of two");
+
+// open addressing, linear probing, ptr NULL marks a free entry
+typedef struct {
+    void *ptr;
+    uint32_t size : 24;
+    uint32_t slot : 8;
+} block_t;
+
+static block_t map[MAP_LEN];
+static struct {
+    TaskHandle_t task;
+    heapacct_task_t stats;
+} tasks[HEAPACCT_MAX_TASKS] = {
+    [ISR_SLOT] = {.stats = {.name = "isr"}},
+    [BOOT_SLOT] = {.stats = {.name = "boot"}},
+    [OTHER_SLOT] = {.stats = {.name = "other"}},
+};
+static size_t task_count = OTHER_SLOT + 1;
+static size_t map_used;
+static heapacct_site_t sites[HEAPACCT_MAX_SITES];
+static uint32_t untracked;
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t hash(void *ptr) { return (((uintptr_t)ptr >> 3) * 2654435761u) & (MAP_LEN - 1); }
+
+// caller of malloc/calloc/heap_caps_*, a fixed number of frames up
+static uint32_t IRAM_ATTR caller_pc() {
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+    esp_backtrace_frame_t frame = {};
+    esp_backtrace_get_start(&frame.pc, &frame.sp, &frame.next_pc);
+    for (int i = 0; i < CONFIG_HEAPACCT_CALLER_DEPTH && esp_backtrace_get_next_frame(&frame); i++)
+        ;
+    return esp_cpu_process_stack_pc(frame.pc);
+#else
+    return (uint32_t)(uintptr_t)__builtin_return_address(0);
+#endif
+}
+
+static size_t IRAM_ATTR task_slot() {
+    if (xPortInIsrContext())
+        return ISR_SLOT;
+    // allocations before the scheduler runs have no task to go to
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+        return BOOT_SLOT;
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (task == NULL)
+        return BOOT_SLOT;
+    for (size_t i = OTHER_SLOT + 1; i < task_count; i++) {
+        if (tasks[i].task == task)
+            return i;
+    }
+    if (task_count == HEAPACCT_MAX_TASKS)
+        return OTHER_SLOT;
+    tasks[task_count].task = task;
+    strncpy(tasks[task_count].stats.name, pcTaskGetName(task), sizeof(tasks[task_count].stats.name) - 1);
+    return task_count++;
+}
+
+// space saving: an unknown site takes over the rarest entry
+static void IRAM_ATTR count_site(uint32_t pc, size_t size) {
+    heapacct_site_t *min = &sites[0];
+    for (size_t i = 0; i < HEAPACCT_MAX_SITES; i++) {
+        if (sites[i].pc == pc) {
+            sites[i].allocs++;
+            sites[i].bytes += size;
+            return;
+        }
+        if (sites[i].allocs < min->allocs)
+            min = &sites[i];
+    }
+    min->pc = pc;
+    min->allocs++;
+    min->bytes = size;
+}
+
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+    uint32_t pc = caller_pc();
+    portENTER_CRITICAL_SAFE(&lock);
+    size_t slot = task_slot();
+    heapacct_task_t *t = &tasks[slot].stats;
+    t->allocs++;
+    count_site(pc, size);
+
+    if (map_used < MAP_LOAD_MAX && size < (1 << 24)) {
+        uint32_t i = hash(ptr);
+        while (map[i].ptr)
+            i = (i + 1) & (MAP_LEN - 1);
+        map[i] = (block_t){.ptr = ptr, .size = size, .slot = slot};
+        map_used++;
+        t->live += size;
+        if (t->live > t->peak)
+            t->peak = t->live;
+    } else {
+        untracked++;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr) {
+    if (ptr == NULL)
+        return;
+    portENTER_CRITICAL_SAFE(&lock);
+    uint32_t i = hash(ptr);
+    for (uint32_t n = 0; n < MAP_LEN && map[i].ptr && map[i].ptr != ptr; n++)
+        i = (i + 1) & (MAP_LEN - 1);
+    if (map[i].ptr == ptr) {
+        heapacct_task_t *t = &tasks[map[i].slot].stats;
+        t->live -= map[i].size;
+        t->frees++;
+        map_used--;
+        // backward shift deletion keeps every probe chain unbroken
+        uint32_t hole = i;
+        uint32_t j = (i + 1) & (MAP_LEN - 1);
+        for (uint32_t n = 0; n < MAP_LEN && map[j].ptr; n++, j = (j + 1) & (MAP_LEN - 1)) {
+            uint32_t home = hash(map[j].ptr);
+            if (((j - home) & (MAP_LEN - 1)) >= ((j - hole) & (MAP_LEN - 1))) {
+                map[hole] = map[j];
+                hole = j;
+            }
+        }
+        map[hole].ptr = NULL;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+}
+
+size_t heapacct_tasks(heapacct_task_t *out, size_t max) {
+    portENTER_CRITICAL(&lock);
+    size_t n = task_count < max ? task_count : max;
+    for (size_t i = 0; i < n; i++)
+        out[i] = tasks[i].stats;
+    portEXIT_CRITICAL(&lock);
+    return n;
+}
+
+size_t heapacct_sites(heapacct_site_t *out, size_t max) {
+    size_t n = 0;
+    portENTER_CRITICAL(&lock);
+    for (size_t i = 0; i < HEAPACCT_MAX_SITES && n < max; i++) {
+        if (sites[i].allocs)
+            out[n++] = sites[i];
+    }
+    portEXIT_CRITICAL(&lock);
+    // insertion sort, a handful of entries
+    for (size_t i = 1; i < n; i++) {
+        heapacct_site_t s = out[i];
+        size_t j = i;
+        for (; j > 0 && out[j - 1].allocs < s.allocs; j--)
+            out[j] = out[j - 1];
+        out[j] = s;
+    }
+    return n;
+}
+
+uint32_t heapacct_untracked() { return untracked; }
+
+static void heapacct_report(void *arg) {
+    const uint32_t interval_s = (uintptr_t)arg;
+    static heapacct_task_t now[HEAPACCT_MAX_TASKS];
+    static uint32_t prev_allocs[HEAPACCT_MAX_TASKS];
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(interval_s * 1000));
+        size_t n = heapacct_tasks(now, HEAPACCT_MAX_TASKS);
+        for (size_t i = 0; i < n; i++) {
+            uint32_t rate = (now[i].allocs - prev_allocs[i]) / interval_s;
+            prev_allocs[i] = now[i].allocs;
+            ESP_LOGI(TAG, "%-16s live=%-7u peak=%-7u allocs/s=%lu", now[i].name, (unsigned)now[i].live, (unsigned)now[i].peak, (unsigned long)rate);
+            if (CONFIG_HEAPACCT_RATE_BUDGET && rate > CONFIG_HEAPACCT_RATE_BUDGET)
+                ESP_LOGW(TAG, "%s allocates %lu/s, budget %d", now[i].name, (unsigned long)rate, CONFIG_HEAPACCT_RATE_BUDGET);
+        }
+    }
+}
+
+void heapacct_report_start(uint32_t interval_s) {
+    if (interval_s)
+        tasks_start(TASK_HEAPACCT, heapacct_report, (void *)(uintptr_t)interval_s);
+}
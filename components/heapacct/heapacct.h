@@ -0,0 +1,39 @@
+#ifndef HEAPACCT_H
+#define HEAPACCT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Heap usage per task through the CONFIG_HEAP_USE_HOOKS allocation hooks:
+// every block is charged to the task that allocated it until it is freed,
+// whoever frees it. Without the hooks enabled everything reads zero.
+
+#define HEAPACCT_MAX_TASKS 24
+#define HEAPACCT_MAX_SITES 16
+
+typedef struct {
+    // "isr" for allocations from interrupts, "boot" before the scheduler,
+    // "other" for tasks beyond HEAPACCT_MAX_TASKS
+    char name[16];
+    size_t live;
+    size_t peak;
+    uint32_t allocs;
+    uint32_t frees;
+} heapacct_task_t;
+
+typedef struct {
+    uint32_t pc;  // resolve with addr2line
+    uint32_t allocs;
+    uint32_t bytes;
+} heapacct_site_t;
+
+// copies of the current counters, sites sorted by allocation count
+size_t heapacct_tasks(heapacct_task_t *out, size_t max);
+size_t heapacct_sites(heapacct_site_t *out, size_t max);
+uint32_t heapacct_untracked();
+
+// logs every task's live/peak bytes and allocation rate each interval, and
+// warns about the ones over CONFIG_HEAPACCT_RATE_BUDGET
+void heapacct_report_start(uint32_t interval_s);
+
+#endif
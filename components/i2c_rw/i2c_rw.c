@@ -1,42 +1,67 @@
 #include "driver/i2c.h"
 
+#include "i2c_rw.h"
+#include "trace.h"
+
 #define MASTER_FREQ 400000
 #define MASTER_TIMEOUT 1000
 #define REGISTER_READ_AMOUNT 7
 
-void i2c_read(uint8_t chp_addr, uint8_t port, uint8_t data_addr, uint8_t *data) {
+esp_err_t i2c_read(uint8_t chp_addr, uint8_t port, uint8_t data_addr, uint8_t *data) {
     i2c_cmd_handle_t cmd_handle = i2c_cmd_link_create();
     i2c_master_start(cmd_handle);
     i2c_master_write_byte(cmd_handle, (chp_addr << 1) | I2C_MASTER_WRITE, 1);
     i2c_master_write_byte(cmd_handle, data_addr, 1);
     i2c_master_start(cmd_handle);
     i2c_master_write_byte(cmd_handle, (chp_addr << 1) | I2C_MASTER_READ, 1);
-    i2c_master_read(cmd_handle, data, REGISTER_READ_AMOUNT, I2C_MASTER_ACK);
+    i2c_master_read(cmd_handle, data, REGISTER_READ_AMOUNT, I2C_MASTER_LAST_NACK);
     i2c_master_stop(cmd_handle);
-    i2c_master_cmd_begin(port, cmd_handle, portMAX_DELAY);
+    TRACE_BEGIN("i2c read");
+    esp_err_t err = i2c_master_cmd_begin(port, cmd_handle, pdMS_TO_TICKS(MASTER_TIMEOUT));
+    TRACE_END("i2c read");
     i2c_cmd_link_delete(cmd_handle);
+    return err;
 }
 
-void i2c_write(uint8_t chp_addr, uint8_t port, uint8_t data_addr, uint8_t data) {
+esp_err_t i2c_write(uint8_t chp_addr, uint8_t port, uint8_t data_addr, uint8_t data) {
     i2c_cmd_handle_t cmd_handle_write = i2c_cmd_link_create();
     i2c_master_start(cmd_handle_write);
     i2c_master_write_byte(cmd_handle_write, (chp_addr << 1) | I2C_MASTER_WRITE, 1);
     i2c_master_write_byte(cmd_handle_write, data_addr, 1);
     i2c_master_write_byte(cmd_handle_write, data, 1);
     i2c_master_stop(cmd_handle_write);
-    i2c_master_cmd_begin(port, cmd_handle_write, portMAX_DELAY);
+    TRACE_BEGIN("i2c write");
+    esp_err_t err = i2c_master_cmd_begin(port, cmd_handle_write, pdMS_TO_TICKS(MASTER_TIMEOUT));
+    TRACE_END("i2c write");
+    i2c_cmd_link_delete(cmd_handle_write);
+    return err;
+}
+
+esp_err_t i2c_write_burst(uint8_t chp_addr, uint8_t port, uint8_t data_addr, const uint8_t *data, size_t len) {
+    i2c_cmd_handle_t cmd_handle_write = i2c_cmd_link_create();
+    i2c_master_start(cmd_handle_write);
+    i2c_master_write_byte(cmd_handle_write, (chp_addr << 1) | I2C_MASTER_WRITE, 1);
+    i2c_master_write_byte(cmd_handle_write, data_addr, 1);
+    i2c_master_write(cmd_handle_write, data, len, 1);
+    i2c_master_stop(cmd_handle_write);
+    TRACE_BEGIN("i2c write");
+    esp_err_t err = i2c_master_cmd_begin(port, cmd_handle_write, pdMS_TO_TICKS(MASTER_TIMEOUT));
+    TRACE_END("i2c write");
     i2c_cmd_link_delete(cmd_handle_write);
+    return err;
 }
 
-void i2c_init(uint8_t sda, uint8_t scl, uint8_t port) {
+esp_err_t i2c_init(uint8_t sda, uint8_t scl, uint8_t port) {
     i2c_config_t i2c_conf = {
         .mode = I2C_MODE_MASTER,
         .scl_pullup_en = GPIO_PULLUP_ENABLE,
         .sda_pullup_en = GPIO_PULLUP_ENABLE,
         .scl_io_num = scl,
         .sda_io_num = sda,
-        .master.clk_speed = 400000,
+        .master.clk_speed = MASTER_FREQ,
     };
-    i2c_param_config(port, &i2c_conf);
-    i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0);
+    esp_err_t err = i2c_param_config(port, &i2c_conf);
+    if (err != ESP_OK)
+        return err;
+    return i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0);
 };
@@ -1,10 +1,13 @@
 #ifndef  I2C_RW_H
 #define  I2C_RW_H
 
+#include <stddef.h>
 #include "esp_err.h"
 
 esp_err_t i2c_read(uint8_t chp_addr, uint8_t port, uint8_t data_addr, uint8_t* data);
 esp_err_t i2c_write(uint8_t chp_addr, uint8_t port, uint8_t data_addr, uint8_t data);
+// len bytes to consecutive registers from data_addr in one transaction
+esp_err_t i2c_write_burst(uint8_t chp_addr, uint8_t port, uint8_t data_addr, const uint8_t* data, size_t len);
 esp_err_t i2c_init(uint8_t sda, uint8_t scl, uint8_t port);
 
 #endif
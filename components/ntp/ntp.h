@@ -1,9 +1,7 @@
 #ifndef NTP_H
 #define NTP_H
-#include <time.h>
-
-extern struct tm timeinfo;
 
+// starts SNTP without waiting for it, every sync steers the clock component
 void ntp_init(void);
 
 #endif
@@ -7,6 +7,7 @@
 #include "esp_ota_ops.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "tasks.h"
 
 #define intr_button 0
 #define TAG "OTA"
@@ -256,5 +257,5 @@ void ota_start(void) {
 
 	intr_setup();
 
-	xTaskCreate(ota_setup, "function to be executed", 1024 * 8, NULL, 2, NULL);
+	tasks_start(TASK_OTA, ota_setup, NULL);
 }
@@ -1,9 +1,51 @@
 #ifndef _DHT22_H_
 #define _DHT22_H_
 
-void dht22_init();
+#include <stddef.h>
+#include <stdint.h>
+#include <driver/gpio.h>
+#include <esp_err.h>
+#include "stats.h"
+
+#define DHT22_MAX_PROBES 8
+// read period limits: the sensor's own minimum, and an hour
+#define DHT22_PERIOD_MIN_MS 2000
+#define DHT22_PERIOD_MAX_MS 3600000
+
+typedef struct {
+    gpio_num_t pin;
+    const char *name;
+} dht22_probe_t;
+
+// all probes are served by one task, reads are staggered across the period
+void dht22_init(const dht22_probe_t *probes, size_t count);
+size_t dht22_probe_count();
+const char *dht22_probe_name(size_t probe);
+float dht22_get_humidity(size_t probe);
+float dht22_get_temperature(size_t probe);
+
+// per probe read outcomes since boot, failures split like the old
+// DHT_TIMEOUT_ERROR / DHT_CHECKSUM_ERROR codes
+typedef struct {
+    uint32_t reads;
+    uint32_t timeouts;
+    uint32_t checksum_errors;
+    uint32_t other_errors;
+} dht22_counters_t;
+
+void dht22_get_counters(size_t probe, dht22_counters_t *out);
+// duration of each read in us, every probe together
+const stats_hist_t *dht22_read_hist();
+
+// runtime control; periods outside DHT22_PERIOD_MIN_MS..MAX_MS are refused
+esp_err_t dht22_set_period(uint32_t period_ms);
+uint32_t dht22_period_ms();
+// reads every probe right away, one after the other (still never sooner
+// than 2s after a probe's previous read); the regular slots stay as they are
+void dht22_read_now();
+
+// first probe, kept for the single sensor boards
 float get_humidity();
 float get_temperature();
 
 #endif 
-
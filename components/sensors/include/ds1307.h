@@ -0,0 +1,12 @@
+#ifndef _DS1307_H_
+#define _DS1307_H_
+
+// Reads the RTC once to seed the clock (corrected by the stored drift) and
+// then only touches the bus again when SNTP syncs, from its own task: to
+// refine the drift estimate and to rewrite the RTC once it has wandered off.
+void tinyRTC_init();
+
+// last estimated drift of the RTC crystal, parts per billion, + means fast
+int32_t ds1307_drift_ppb();
+
+#endif
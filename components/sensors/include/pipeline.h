@@ -0,0 +1,56 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "filter.h"
+#include "stats.h"
+
+// Three stages, each on its own side of a lock-free SPSC ring:
+//   acquisition (core 1, high priority) only reads the sensor and submits,
+//   processing (core 1, low priority) runs each value through its filter
+//   chain (filter.h) and publishes the snapshot,
+//   networking (core 0) is woken for every published sample.
+// Core and priority of every stage live in the task table (tasks.h).
+
+typedef enum {
+    PIPELINE_DHT,
+    PIPELINE_TSL2561,
+    PIPELINE_BENCH,  // synthetic samples from CONFIG_PIPELINE_BENCH_HZ
+    PIPELINE_SOURCES,
+} pipeline_source_t;
+
+typedef struct {
+    int64_t stamp_us;  // acquisition time
+    uint8_t channel;   // probe index within the source
+    fix_t value[2];    // dht: humidity, temperature; tsl2561: raw ch0, ch1 counts
+    uint8_t gain;      // tsl2561: what the counts were taken with
+    uint8_t integ;
+} pipeline_sample_t;
+
+typedef struct {
+    uint32_t version;  // snapshot version the sample was published as
+    int64_t stamp_us;
+} pipeline_event_t;
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t dropped;  // acquisition rings full, processing fell behind
+    uint32_t processed;
+    uint32_t events_dropped;  // networking fell behind, it still reads the snapshot
+} pipeline_stats_t;
+
+void pipeline_init();
+// stage 1: only ever called from the one acquisition task of that source
+bool pipeline_submit(pipeline_source_t source, const pipeline_sample_t *sample);
+// stage 3: the task notified (xTaskNotifyGive) after every published sample
+void pipeline_set_consumer(TaskHandle_t task);
+bool pipeline_next(pipeline_event_t *out);
+
+void pipeline_get_stats(pipeline_stats_t *out);
+// acquisition to publish, in us
+stats_hist_t *pipeline_latency_hist();
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include "stats.h"
+
+#define SAMPLER_MAX_CHANNELS 16
+
+// Absolute-deadline pacing for an acquisition loop: wakes are anchored to
+// the first deadline, so the time spent reading never shifts the period.
+typedef struct {
+    const char *name;
+    TickType_t period;
+    TickType_t last_wake;
+    TickType_t base_tick;
+    int64_t base_us;
+    uint32_t overruns;        // since the last reset, goes with the jitter window
+    uint32_t overruns_total;  // since boot, for counters that must not go back
+    stats_hist_t jitter;  // wake lateness in us
+    uint32_t reset_gen;   // last sampler_reset_stats() this one has applied
+} sampler_t;
+
+// takes the anchor all deadlines are counted from, on a tick edge; call it
+// once before the sampling tasks start (sampler_init takes an unaligned one
+// if nobody did)
+void sampler_anchor();
+
+// phase_ms offsets the deadlines from the common anchor, so loops sharing a
+// period interleave; never sleeps
+void sampler_init(sampler_t *sampler, const char *name, uint32_t period_ms, uint32_t phase_ms);
+// blocks until the next deadline; a missed deadline counts as an overrun
+void sampler_wait(sampler_t *sampler);
+// takes effect from the deadline after the one already being waited for
+void sampler_set_period(sampler_t *sampler, uint32_t period_ms);
+
+// logs every channel's jitter percentiles each interval and resets the window
+void sampler_report_start(uint32_t interval_s);
+
+// clears every jitter window and overrun count, each at its sampler's next wake
+void sampler_reset_stats();
+
+size_t sampler_count();
+const sampler_t *sampler_get(size_t index);
+
+#endif
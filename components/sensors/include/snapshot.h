@@ -0,0 +1,31 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stdint.h>
+#include "dht22.h"
+
+// latest value of every sensor channel, copied out as one consistent unit
+typedef struct {
+    uint32_t version;  // bumped on every publish
+    int64_t stamp_us;  // esp_timer time the newest sample was acquired
+    uint8_t dht_count;
+    float humidity[DHT22_MAX_PROBES];
+    float temperature[DHT22_MAX_PROBES];
+    int64_t dht_stamp_us[DHT22_MAX_PROBES];  // per probe, channels don't move each other's
+    float lux;
+    int64_t lux_stamp_us;  // 0 until the first lux reading
+    float accel[3];
+    float gyro[3];
+} sensor_snapshot_t;
+
+// writers: never sleep, safe to call from any task; return the new version.
+// stamp_us is when the sample was acquired (esp_timer), not when it is published
+uint32_t snapshot_publish_dht(uint8_t probe, float humidity, float temperature, int64_t stamp_us);
+uint32_t snapshot_publish_lux(float lux, int64_t stamp_us);
+uint32_t snapshot_publish_motion(const float accel[3], const float gyro[3], int64_t stamp_us);
+
+// readers: lock free, retries only if a publish raced the copy
+void snapshot_read(sensor_snapshot_t *out);
+uint32_t snapshot_version();
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _SPSC_H_
+#define _SPSC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Single-producer single-consumer ring of fixed-size records. Only the
+// producer writes head and only the consumer writes tail, so neither side
+// locks or masks interrupts and the two may run on different cores. A full
+// ring drops the new record and counts it, the producer never waits.
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+    uint32_t mask;
+    size_t size;
+    uint8_t *slots;
+} spsc_t;
+
+// len must be a power of two
+#define SPSC_DEFINE(name, type, len)                                                     \
+    _Static_assert(((len) & ((len) - 1)) == 0, #name " length must be a power of two"); \
+    static type name##_slots[len];                                                       \
+    static spsc_t name = {.mask = (len) - 1, .size = sizeof(type), .slots = (uint8_t *)name##_slots}
+
+static inline bool spsc_push(spsc_t *q, const void *item) {
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    if (head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) > q->mask) {
+        q->dropped++;
+        return false;
+    }
+    memcpy(q->slots + (head & q->mask) * q->size, item, q->size);
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static inline bool spsc_pop(spsc_t *q, void *item) {
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == tail)
+        return false;
+    memcpy(item, q->slots + (tail & q->mask) * q->size, q->size);
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// records pushed so far, dropped ones excluded; safe from any task
+static inline uint32_t spsc_pushed(const spsc_t *q) { return __atomic_load_n(&q->head, __ATOMIC_RELAXED); }
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _TSL2561_H_
+#define _TSL2561_H_
+
+#include <stdint.h>
+#include "tsl2561_lux.h"
+
+#if CONFIG_TSL2561_PACKAGE_T
+#define TSL2561_PACKAGE TSL2561_PACKAGE_T
+#else
+#define TSL2561_PACKAGE TSL2561_PACKAGE_CS
+#endif
+
+typedef struct {
+    uint32_t reads;
+    uint32_t errors;  // i2c failures
+    uint32_t saturated;
+    uint32_t range_changes;
+} tsl2561_counters_t;
+
+// Reads the sensor every CONFIG_TSL2561_PERIOD_MS, picking gain and
+// integration time from the last reading; it only draws power while it
+// integrates.
+void tsl2561_init();
+void tsl2561_get_counters(tsl2561_counters_t *out);
+float get_lux();
+
+#endif
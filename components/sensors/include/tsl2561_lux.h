@@ -0,0 +1,35 @@
+#ifndef _TSL2561_LUX_H_
+#define _TSL2561_LUX_H_
+
+#include <stdint.h>
+
+// Lux from raw TSL2561 channel counts in integer arithmetic only, the TAOS
+// reference algorithm. Kept free of ESP-IDF headers so the host check
+// (tools/lux_check.py) builds the same file.
+
+typedef enum {
+    TSL2561_PACKAGE_T,  // also FN and CL
+    TSL2561_PACKAGE_CS,
+} tsl2561_package_t;
+
+typedef enum {
+    TSL2561_GAIN_1X = 0,
+    TSL2561_GAIN_16X = 1,
+} tsl2561_gain_t;
+
+// values match the INTEG field of the timing register
+typedef enum {
+    TSL2561_INTEG_13MS = 0,
+    TSL2561_INTEG_101MS = 1,
+    TSL2561_INTEG_402MS = 2,
+} tsl2561_integ_t;
+
+// ADC ceiling of each integration time, a channel at it is saturated
+#define TSL2561_MAX_13MS 5047
+#define TSL2561_MAX_101MS 37177
+#define TSL2561_MAX_402MS 65535
+
+// ch0 is visible plus infrared, ch1 infrared only; rounded to whole lux
+uint32_t tsl2561_lux(tsl2561_package_t package, uint16_t ch0, uint16_t ch1, tsl2561_gain_t gain, tsl2561_integ_t integ);
+
+#endif
@@ -1,34 +1,152 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
 #include <dht.h>
 
+#include "dlog.h"
+#include "dht22.h"
+#include "pipeline.h"
+#include "sampler.h"
+#include "snapshot.h"
+#include "tasks.h"
+#include "trace.h"
+
 #define SENSOR_TYPE DHT_TYPE_AM2301
-#define DATA_PIN 27
+// a DHT22 must not be polled faster than every 2s
+#define READ_PERIOD_MS DHT22_PERIOD_MIN_MS
+
+#define TAG "DHT22"
+
+static dht22_probe_t probes[DHT22_MAX_PROBES];
+static sampler_t samplers[DHT22_MAX_PROBES];
+static dht22_counters_t counters[DHT22_MAX_PROBES];
+static stats_hist_t read_hist;
+static size_t probe_count = 0;
+static uint32_t period_ms = READ_PERIOD_MS;
+static TaskHandle_t dht_task;
+// one bit per probe still owed a read from dht22_read_now()
+static uint32_t read_pending;
 
-float temperature, humidity = 0;
+_Static_assert(DHT22_MAX_PROBES <= 32, "read_pending is a 32 bit mask");
 
 static void dht_test(void *pvParameters);
 
-float get_humidity() { return humidity; }
+size_t dht22_probe_count() { return probe_count; }
+
+const char *dht22_probe_name(size_t probe) { return probe < probe_count ? probes[probe].name : NULL; }
+
+float dht22_get_humidity(size_t probe)
+{
+    sensor_snapshot_t snap;
+    snapshot_read(&snap);
+    return probe < snap.dht_count ? snap.humidity[probe] : 0;
+}
+
+float dht22_get_temperature(size_t probe)
+{
+    sensor_snapshot_t snap;
+    snapshot_read(&snap);
+    return probe < snap.dht_count ? snap.temperature[probe] : 0;
+}
+
+void dht22_get_counters(size_t probe, dht22_counters_t *out)
+{
+    if (probe < probe_count)
+        *out = counters[probe];
+}
+
+const stats_hist_t *dht22_read_hist() { return &read_hist; }
+
+esp_err_t dht22_set_period(uint32_t ms)
+{
+    if (ms < DHT22_PERIOD_MIN_MS || ms > DHT22_PERIOD_MAX_MS)
+        return ESP_ERR_INVALID_ARG;
+    period_ms = ms;
+    for (size_t i = 0; i < probe_count; i++)
+        sampler_set_period(&samplers[i], ms);
+    return ESP_OK;
+}
+
+uint32_t dht22_period_ms() { return period_ms; }
 
-float get_temperature() { return temperature; }
+// the probe being waited for is woken, the others skip their next wait
+void dht22_read_now()
+{
+    if (dht_task == NULL)
+        return;
+    __atomic_store_n(&read_pending, (1u << probe_count) - 1, __ATOMIC_RELEASE);
+    xTaskAbortDelay(dht_task);
+}
+
+float get_humidity() { return dht22_get_humidity(0); }
 
-void dht22_init()
+float get_temperature() { return dht22_get_temperature(0); }
+
+void dht22_init(const dht22_probe_t *conf, size_t count)
 {
-    xTaskCreatePinnedToCore(dht_test, "dht_test", configMINIMAL_STACK_SIZE * 3, NULL, 5, NULL,1);
+    if (count > DHT22_MAX_PROBES) {
+        ESP_LOGW(TAG, "%u probes requested, only %d supported", (unsigned)count, DHT22_MAX_PROBES);
+        count = DHT22_MAX_PROBES;
+    }
+    for (size_t i = 0; i < count; i++) {
+        probes[i] = conf[i];
+        gpio_set_pull_mode(conf[i].pin, GPIO_PULLUP_ONLY);
+    }
+    probe_count = count;
+    if (probe_count == 0)
+        return;
+    dht_task = tasks_start(TASK_DHT, dht_test, NULL);
 }
 
+// The dht driver bit-bangs each frame with interrupts masked, so every probe is
+// read from this one task in its own slot of the period: two reads can never
+// overlap and the critical sections are spread evenly instead of bunched up.
+// Good readings go straight to the pipeline, publishing happens in its
+// processing stage.
 static void dht_test(void *pvParameters)
 {
-    gpio_set_pull_mode(DATA_PIN, GPIO_PULLUP_ONLY);
+    int64_t last_read_us[DHT22_MAX_PROBES] = {};
+    for (size_t i = 0; i < probe_count; i++)
+        sampler_init(&samplers[i], probes[i].name, period_ms, i * period_ms / probe_count);
 
     while (1)
     {
-        if (dht_read_float_data(1, DATA_PIN, &humidity, &temperature) == ESP_OK)
-            printf("Humidity: %.1f%% Temp: %.1fC\n", humidity, temperature);
-        else
-            printf("Could not read data from sensor\n");
+        for (size_t i = 0; i < probe_count; i++) {
+            uint32_t bit = 1u << i;
+            if (!(__atomic_fetch_and(&read_pending, ~bit, __ATOMIC_ACQ_REL) & bit))
+                sampler_wait(&samplers[i]);
+            // the wait may have been cut short for this very read
+            __atomic_fetch_and(&read_pending, ~bit, __ATOMIC_ACQ_REL);
+            // dht22_read_now() may have cut the wait short (or this delay)
+            int64_t since_us;
+            while ((since_us = esp_timer_get_time() - last_read_us[i]) < READ_PERIOD_MS * 1000LL)
+                vTaskDelay(pdMS_TO_TICKS(READ_PERIOD_MS - since_us / 1000) + 1);
+            last_read_us[i] = esp_timer_get_time();
 
-        vTaskDelay(pdMS_TO_TICKS(2000));
+            // tenths of a % and a degree; filtering and floats are left to processing
+            int16_t humidity, temperature;
+            TRACE_BEGIN("dht read");
+            esp_err_t err = dht_read_data(SENSOR_TYPE, probes[i].pin, &humidity, &temperature);
+            TRACE_END("dht read");
+            stats_hist_record(&read_hist, esp_timer_get_time() - last_read_us[i]);
+            counters[i].reads++;
+            if (err == ESP_OK) {
+                pipeline_sample_t sample = {
+                    .stamp_us = last_read_us[i],
+                    .channel = i,
+                    .value = {FIX_FROM_INT(humidity) / 10, FIX_FROM_INT(temperature) / 10},
+                };
+                pipeline_submit(PIPELINE_DHT, &sample);
+            } else {
+                if (err == ESP_ERR_TIMEOUT)
+                    counters[i].timeouts++;
+                else if (err == ESP_ERR_INVALID_CRC)
+                    counters[i].checksum_errors++;
+                else
+                    counters[i].other_errors++;
+                DLOGW(TAG, "%s: Could not read data from sensor (%d)", probes[i].name, err);
+            }
+        }
     }
 }
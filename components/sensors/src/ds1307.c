@@ -0,0 +1,177 @@
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <nvs.h>
+#include <driver/i2c.h>
+
+#include "clock.h"
+#include "ds1307.h"
+#include "i2c_rw.h"
+#include "tasks.h"
+
+#define CHP_SDA1 18
+#define CHP_SCL1 19
+#define MASTER_PORT1 I2C_NUM_1
+
+#define RTC_ADDR 0x68
+#define RTC_CONTROL 0xb3
+#define CLOCK_HALT 0x80
+
+// the RTC only counts whole seconds, so a drift estimate needs a long window
+// to mean anything: 1s over 6h is ~46ppm, over a week ~1.7ppm
+#define DRIFT_MIN_WINDOW_S (6 * 3600)
+#define DRIFT_WRITE_THRESHOLD_S 2
+
+#define NVS_NAMESPACE "ds1307"
+#define NVS_DRIFT "drift_ppb"
+#define NVS_SET_AT "set_at"
+
+#define TAG "RTC"
+
+static int32_t drift_ppb = 0;
+static int64_t set_at = 0;  // UTC seconds of the last write to the RTC, 0 if unknown
+static bool present = false;
+static TaskHandle_t sync_task = NULL;
+static portMUX_TYPE pending_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t pending_us = 0;
+
+static uint8_t to_bcd(int value) { return ((value / 10) << 4) | (value % 10); }
+static int from_bcd(uint8_t value) { return (value >> 4) * 10 + (value & 0x0f); }
+
+// days since 1970-01-01 of a proleptic Gregorian date
+static int64_t days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const int yoe = y - era * 400;
+    const int doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t)era * 146097 + doe - 719468;
+}
+
+// RTC time in UTC seconds, -1 if it is halted or unreadable
+static int64_t rtc_read() {
+    uint8_t data[7] = {};
+    if (i2c_read(RTC_ADDR, MASTER_PORT1, 0x00, data) != ESP_OK)
+        return -1;
+    if (data[0] & CLOCK_HALT)
+        return -1;
+    int64_t days = days_from_civil(2000 + from_bcd(data[6]), from_bcd(data[5] & 0x1f), from_bcd(data[4] & 0x3f));
+    return days * 86400 + from_bcd(data[2] & 0x3f) * 3600 + from_bcd(data[1] & 0x7f) * 60 + from_bcd(data[0] & 0x7f);
+}
+
+static void rtc_write(int64_t utc_s) {
+    time_t now = utc_s;
+    struct tm utc;
+    gmtime_r(&now, &utc);
+
+    // registers 0x00-0x07 in one transaction, so the RTC can't tick between
+    // the seconds and the minutes and the clock-halt bit clears with the rest
+    const uint8_t regs[8] = {
+        to_bcd(utc.tm_sec),      to_bcd(utc.tm_min),     to_bcd(utc.tm_hour),       to_bcd(utc.tm_wday + 1),
+        to_bcd(utc.tm_mday),     to_bcd(utc.tm_mon + 1), to_bcd(utc.tm_year % 100), RTC_CONTROL,
+    };
+    if (i2c_write_burst(RTC_ADDR, MASTER_PORT1, 0x00, regs, sizeof(regs)) != ESP_OK) {
+        ESP_LOGE(TAG, "RTC write failed");
+        return;
+    }
+
+    ESP_LOGI(TAG, "Synced time = %04d-%02d-%02d %02d:%02d:%02d UTC", utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min,
+             utc.tm_sec);
+}
+
+static void drift_load() {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+        return;
+    nvs_get_i32(nvs, NVS_DRIFT, &drift_ppb);
+    nvs_get_i64(nvs, NVS_SET_AT, &set_at);
+    nvs_close(nvs);
+}
+
+static void drift_store() {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        ESP_LOGE(TAG, "can't open nvs, drift estimate is lost on reboot");
+        return;
+    }
+    nvs_set_i32(nvs, NVS_DRIFT, drift_ppb);
+    nvs_set_i64(nvs, NVS_SET_AT, set_at);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+// error the stored drift predicts for an RTC that was set at set_at
+static int64_t drift_correction(int64_t rtc_s) {
+    if (set_at == 0 || rtc_s <= set_at)
+        return 0;
+    return (rtc_s - set_at) * drift_ppb / 1000000000;
+}
+
+static void sync_rtc(int64_t ntp_s) {
+    int64_t rtc_s = rtc_read();
+    if (rtc_s < 0 || set_at == 0) {
+        set_at = ntp_s;
+        rtc_write(ntp_s);
+        drift_store();
+        return;
+    }
+
+    int64_t error_s = rtc_s - ntp_s;
+    int64_t window_s = ntp_s - set_at;
+    if (window_s >= DRIFT_MIN_WINDOW_S) {
+        int32_t measured = error_s * 1000000000 / window_s;
+        // blend with the previous estimate, a single window is only good to a second
+        drift_ppb = drift_ppb ? (drift_ppb + measured) / 2 : measured;
+        ESP_LOGI(TAG, "drift %+ld s over %lld s, estimate %+ld ppb", (long)error_s, (long long)window_s, (long)drift_ppb);
+    }
+    if (error_s >= DRIFT_WRITE_THRESHOLD_S || error_s <= -DRIFT_WRITE_THRESHOLD_S) {
+        set_at = ntp_s;
+        rtc_write(ntp_s);
+    }
+    drift_store();
+}
+
+// The sync callback runs on the lwIP thread, the bus and the NVS commit are
+// left to this task. Only the latest sync matters, older ones are dropped.
+static void rtc_task(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        portENTER_CRITICAL(&pending_lock);
+        int64_t utc_us = pending_us;
+        portEXIT_CRITICAL(&pending_lock);
+        sync_rtc(utc_us / 1000000);
+    }
+}
+
+static void on_clock_sync(int64_t utc_us, clock_source_t source) {
+    if (source != CLOCK_SOURCE_SNTP || !sync_task)
+        return;
+    portENTER_CRITICAL(&pending_lock);
+    pending_us = utc_us;
+    portEXIT_CRITICAL(&pending_lock);
+    xTaskNotifyGive(sync_task);
+}
+
+int32_t ds1307_drift_ppb() { return drift_ppb; }
+
+void tinyRTC_init() {
+    i2c_init(CHP_SDA1, CHP_SCL1, MASTER_PORT1);
+    drift_load();
+
+    int64_t rtc_s = rtc_read();
+    present = rtc_s >= 0 || i2c_write(RTC_ADDR, MASTER_PORT1, 0x07, RTC_CONTROL) == ESP_OK;
+    if (!present) {
+        ESP_LOGE(TAG, "no RTC on the bus");
+        return;
+    }
+    sync_task = tasks_start(TASK_RTC, rtc_task, NULL);
+    clock_on_sync(on_clock_sync);
+
+    if (rtc_s < 0) {
+        ESP_LOGW(TAG, "RTC is halted, waiting for SNTP to set it");
+        set_at = 0;
+    } else if (!clock_is_set()) {
+        int64_t utc_s = rtc_s - drift_correction(rtc_s);
+        clock_set_utc(utc_s * 1000000, CLOCK_SOURCE_RTC);
+        ESP_LOGI(TAG, "clock seeded from RTC, drift correction %lld s", (long long)(rtc_s - utc_s));
+    }
+}
@@ -0,0 +1,177 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "dlog.h"
+#include "dht22.h"
+#include "filter.h"
+#include "pipeline.h"
+#include "sampler.h"
+#include "snapshot.h"
+#include "spsc.h"
+#include "tsl2561.h"
+#include "tasks.h"
+
+#define TAG "PIPELINE"
+
+SPSC_DEFINE(dht_ring, pipeline_sample_t, CONFIG_PIPELINE_QUEUE_LEN);
+SPSC_DEFINE(tsl_ring, pipeline_sample_t, CONFIG_PIPELINE_QUEUE_LEN);
+SPSC_DEFINE(bench_ring, pipeline_sample_t, CONFIG_PIPELINE_QUEUE_LEN);
+SPSC_DEFINE(events, pipeline_event_t, CONFIG_PIPELINE_QUEUE_LEN);
+
+static spsc_t *const rings[PIPELINE_SOURCES] = {
+    [PIPELINE_DHT] = &dht_ring,
+    [PIPELINE_TSL2561] = &tsl_ring,
+    [PIPELINE_BENCH] = &bench_ring,
+};
+
+static TaskHandle_t process_task;
+static TaskHandle_t consumer;
+static uint32_t processed;
+static stats_hist_t latency_hist;
+
+// one chain per value of every channel, only touched by the processing task
+static filter_chain_t dht_filters[DHT22_MAX_PROBES][2];
+static filter_chain_t lux_filter;
+static filter_chain_t bench_filter;
+
+static const filter_conf_t dht_filter_conf[] = {
+    {.kind = FILTER_MEDIAN, .window = CONFIG_DHT_FILTER_MEDIAN},
+    {.kind = FILTER_EMA, .shift = CONFIG_DHT_FILTER_EMA_SHIFT},
+#if CONFIG_DHT_FILTER_KALMAN
+    {.kind = FILTER_KALMAN,
+     .kalman = {.q = (fix_t)((int64_t)CONFIG_DHT_KALMAN_Q_MILLI * FIX_ONE / 1000), .r = (fix_t)((int64_t)CONFIG_DHT_KALMAN_R_MILLI * FIX_ONE / 1000)}},
+#endif
+};
+
+#if CONFIG_TSL2561
+// lux goes through as a plain integer rather than Q16.16, which would
+// overflow in daylight; the median and the EMA work at any scale
+static const filter_conf_t lux_filter_conf[] = {
+    {.kind = FILTER_MEDIAN, .window = CONFIG_TSL2561_FILTER_MEDIAN},
+    {.kind = FILTER_EMA, .shift = CONFIG_TSL2561_FILTER_EMA_SHIFT},
+};
+#endif
+
+// the bench channel runs every filter so its throughput includes them
+static const filter_conf_t bench_filter_conf[] = {
+    {.kind = FILTER_MEDIAN, .window = 5},
+    {.kind = FILTER_EMA, .shift = 2},
+    {.kind = FILTER_KALMAN, .kalman = {.q = FIX_ONE / 100, .r = FIX_ONE / 4}},
+};
+
+static uint32_t process_dht(const pipeline_sample_t *s) {
+    float humidity = FIX_TO_FLOAT(filter_chain_step(&dht_filters[s->channel][0], s->value[0]));
+    float temperature = FIX_TO_FLOAT(filter_chain_step(&dht_filters[s->channel][1], s->value[1]));
+    DLOGI(TAG, "%s: Humidity: %.1f%% Temp: %.1fC", dht22_probe_name(s->channel), humidity, temperature);
+    return snapshot_publish_dht(s->channel, humidity, temperature, s->stamp_us);
+}
+
+static uint32_t process_tsl2561(const pipeline_sample_t *s) {
+    uint32_t lux = tsl2561_lux(TSL2561_PACKAGE, s->value[0], s->value[1], s->gain, s->integ);
+    fix_t filtered = filter_chain_step(&lux_filter, (fix_t)lux);
+    return snapshot_publish_lux(filtered, s->stamp_us);
+}
+
+static void process(pipeline_source_t source, const pipeline_sample_t *s) {
+    uint32_t version;
+    switch (source) {
+    case PIPELINE_DHT:
+        if (s->channel >= DHT22_MAX_PROBES)
+            return;
+        version = process_dht(s);
+        break;
+    case PIPELINE_TSL2561:
+        version = process_tsl2561(s);
+        break;
+    default:
+        filter_chain_step(&bench_filter, s->value[0]);
+        return;
+    }
+
+    pipeline_event_t ev = {.version = version, .stamp_us = s->stamp_us};
+    spsc_push(&events, &ev);
+    TaskHandle_t to = consumer;
+    if (to)
+        xTaskNotifyGive(to);
+}
+
+// Stage 2, below acquisition on the same core: it only runs once the reads
+// are done, so however long a filter takes it never delays a sample.
+static void process_loop(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        pipeline_sample_t s;
+        bool more = true;
+        while (more) {
+            more = false;
+            for (size_t src = 0; src < PIPELINE_SOURCES; src++) {
+                if (!spsc_pop(rings[src], &s))
+                    continue;
+                more = true;
+                process(src, &s);
+                int64_t age = esp_timer_get_time() - s.stamp_us;
+                stats_hist_record(&latency_hist, age > 0 ? (uint32_t)age : 0);
+                processed++;
+            }
+        }
+    }
+}
+
+bool pipeline_submit(pipeline_source_t source, const pipeline_sample_t *sample) {
+    if (!spsc_push(rings[source], sample))
+        return false;
+    xTaskNotifyGive(process_task);
+    return true;
+}
+
+void pipeline_set_consumer(TaskHandle_t task) { consumer = task; }
+
+bool pipeline_next(pipeline_event_t *out) { return spsc_pop(&events, out); }
+
+void pipeline_get_stats(pipeline_stats_t *out) {
+    out->submitted = 0;
+    out->dropped = 0;
+    for (size_t src = 0; src < PIPELINE_SOURCES; src++) {
+        out->submitted += spsc_pushed(rings[src]);
+        out->dropped += rings[src]->dropped;
+    }
+    out->processed = processed;
+    out->events_dropped = events.dropped;
+}
+
+stats_hist_t *pipeline_latency_hist() { return &latency_hist; }
+
+#if CONFIG_PIPELINE_BENCH_HZ
+// Synthetic acquisition at CONFIG_PIPELINE_BENCH_HZ: paced by a sampler like
+// a real sensor, so /debug/jitter shows its wake lateness and /debug/perf
+// the throughput, with and without network load (tools/pipeline_bench.py).
+static void bench_loop(void *arg) {
+    static sampler_t sampler;
+    sampler_init(&sampler, "bench", 1000 / CONFIG_PIPELINE_BENCH_HZ, 0);
+    pipeline_sample_t s = {};
+    for (uint32_t n = 0;; n++) {
+        sampler_wait(&sampler);
+        s.stamp_us = esp_timer_get_time();
+        // a slow ramp with a spike every 16th sample, so the median has work to do
+        s.value[0] = FIX_FROM_INT(n % 16 ? n / 16 : 1000);
+        pipeline_submit(PIPELINE_BENCH, &s);
+    }
+}
+#endif
+
+void pipeline_init() {
+    for (size_t i = 0; i < DHT22_MAX_PROBES; i++) {
+        filter_chain_init(&dht_filters[i][0], dht_filter_conf, sizeof(dht_filter_conf) / sizeof(dht_filter_conf[0]));
+        filter_chain_init(&dht_filters[i][1], dht_filter_conf, sizeof(dht_filter_conf) / sizeof(dht_filter_conf[0]));
+    }
+#if CONFIG_TSL2561
+    filter_chain_init(&lux_filter, lux_filter_conf, sizeof(lux_filter_conf) / sizeof(lux_filter_conf[0]));
+#endif
+    filter_chain_init(&bench_filter, bench_filter_conf, sizeof(bench_filter_conf) / sizeof(bench_filter_conf[0]));
+    process_task = tasks_start(TASK_PROCESS, process_loop, NULL);
+#if CONFIG_PIPELINE_BENCH_HZ
+    tasks_start(TASK_PIPE_BENCH, bench_loop, NULL);
+#endif
+}
@@ -0,0 +1,107 @@
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "sampler.h"
+#include "tasks.h"
+
+#define TAG "SAMPLER"
+
+static sampler_t *channels[SAMPLER_MAX_CHANNELS];
+static size_t channel_count = 0;
+static portMUX_TYPE channels_lock = portMUX_INITIALIZER_UNLOCKED;
+static TickType_t anchor_tick = 0;
+static int64_t anchor_us = 0;
+// bumped to ask every sampler to clear its window, each one does it itself
+static uint32_t reset_gen = 0;
+
+static void take_anchor() {
+    anchor_tick = xTaskGetTickCount();
+    anchor_us = esp_timer_get_time();
+}
+
+void sampler_anchor() {
+    // line the microsecond base up with a tick edge, deadlines are tick aligned
+    vTaskDelay(1);
+    portENTER_CRITICAL(&channels_lock);
+    take_anchor();
+    portEXIT_CRITICAL(&channels_lock);
+}
+
+void sampler_init(sampler_t *sampler, const char *name, uint32_t period_ms, uint32_t phase_ms) {
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->name = name;
+    sampler->period = pdMS_TO_TICKS(period_ms);
+    sampler->reset_gen = __atomic_load_n(&reset_gen, __ATOMIC_RELAXED);
+
+    // every sampler counts its deadlines from the same anchor, so phases line
+    // up across tasks; the first one is the next slot of the grid still ahead
+    portENTER_CRITICAL(&channels_lock);
+    if (anchor_us == 0)
+        take_anchor();
+    TickType_t base_tick = anchor_tick + pdMS_TO_TICKS(phase_ms);
+    int64_t base_us = anchor_us;
+    TickType_t elapsed = xTaskGetTickCount() - base_tick;
+    if (sampler->period && (int32_t)elapsed >= 0)
+        base_tick += (elapsed / sampler->period + 1) * sampler->period;
+    sampler->base_tick = base_tick;
+    sampler->base_us = base_us + (int64_t)(TickType_t)(base_tick - anchor_tick) * (1000000 / configTICK_RATE_HZ);
+    sampler->last_wake = base_tick - sampler->period;
+    if (channel_count < SAMPLER_MAX_CHANNELS)
+        channels[channel_count++] = sampler;
+    else
+        ESP_LOGW(TAG, "no slot left to publish stats of %s", name);
+    portEXIT_CRITICAL(&channels_lock);
+}
+
+void sampler_wait(sampler_t *sampler) {
+    bool missed = xTaskDelayUntil(&sampler->last_wake, sampler->period) == pdFALSE;
+    uint32_t gen = __atomic_load_n(&reset_gen, __ATOMIC_ACQUIRE);
+    if (sampler->reset_gen != gen) {
+        sampler->reset_gen = gen;
+        stats_hist_reset(&sampler->jitter);
+        sampler->overruns = 0;
+    }
+    if (missed) {
+        // skip the slots we already missed instead of bursting to catch up
+        TickType_t now = xTaskGetTickCount();
+        sampler->overruns++;
+        sampler->overruns_total++;
+        while ((int32_t)(now - sampler->last_wake) >= (int32_t)sampler->period)
+            sampler->last_wake += sampler->period;
+    }
+    int64_t deadline_us = sampler->base_us + (int64_t)(TickType_t)(sampler->last_wake - sampler->base_tick) * (1000000 / configTICK_RATE_HZ);
+    int64_t late_us = esp_timer_get_time() - deadline_us;
+    stats_hist_record(&sampler->jitter, late_us > 0 ? (uint32_t)late_us : 0);
+}
+
+void sampler_set_period(sampler_t *sampler, uint32_t period_ms) { sampler->period = pdMS_TO_TICKS(period_ms); }
+
+// the histograms are only written by their sampling task, which clears its
+// own at the next wake; a reset here would race a record in progress
+void sampler_reset_stats() { __atomic_fetch_add(&reset_gen, 1, __ATOMIC_RELEASE); }
+
+size_t sampler_count() { return channel_count; }
+
+const sampler_t *sampler_get(size_t index) { return index < channel_count ? channels[index] : NULL; }
+
+static void sampler_report(void *arg) {
+    const TickType_t interval = pdMS_TO_TICKS((uintptr_t)arg * 1000);
+    while (1) {
+        vTaskDelay(interval);
+        for (size_t i = 0; i < channel_count; i++) {
+            sampler_t *s = channels[i];
+            ESP_LOGI(TAG, "%-10s n=%-6lu p50=%-6lu p99=%-6lu max=%-6lu overruns=%lu", s->name, (unsigned long)s->jitter.count,
+                     (unsigned long)stats_hist_percentile(&s->jitter, 500), (unsigned long)stats_hist_percentile(&s->jitter, 990),
+                     (unsigned long)s->jitter.max, (unsigned long)s->overruns);
+        }
+        sampler_reset_stats();
+    }
+}
+
+void sampler_report_start(uint32_t interval_s) {
+    if (interval_s)
+        tasks_start(TASK_SAMPLER, sampler_report, (void *)(uintptr_t)interval_s);
+}
@@ -0,0 +1,66 @@
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+
+#include "snapshot.h"
+
+// Seqlock: the sequence is odd while a writer is inside, readers copy the
+// whole snapshot and retry if the sequence moved underneath them. Writers only
+// serialize against each other through a spinlock held for a handful of
+// stores, readers never take it.
+static portMUX_TYPE writer_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t seq = 0;
+static sensor_snapshot_t snap;
+
+static inline void write_begin() {
+    portENTER_CRITICAL(&writer_lock);
+    __atomic_store_n(&seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline uint32_t write_end(int64_t stamp_us) {
+    uint32_t version = ++snap.version;
+    // channels are processed in turn, a later publish may carry an older sample
+    if (stamp_us > snap.stamp_us)
+        snap.stamp_us = stamp_us;
+    __atomic_store_n(&seq, seq + 1, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&writer_lock);
+    return version;
+}
+
+uint32_t snapshot_publish_dht(uint8_t probe, float humidity, float temperature, int64_t stamp_us) {
+    if (probe >= DHT22_MAX_PROBES)
+        return snapshot_version();
+    write_begin();
+    snap.humidity[probe] = humidity;
+    snap.temperature[probe] = temperature;
+    snap.dht_stamp_us[probe] = stamp_us;
+    if (probe >= snap.dht_count)
+        snap.dht_count = probe + 1;
+    return write_end(stamp_us);
+}
+
+uint32_t snapshot_publish_lux(float lux, int64_t stamp_us) {
+    write_begin();
+    snap.lux = lux;
+    snap.lux_stamp_us = stamp_us;
+    return write_end(stamp_us);
+}
+
+uint32_t snapshot_publish_motion(const float accel[3], const float gyro[3], int64_t stamp_us) {
+    write_begin();
+    memcpy(snap.accel, accel, sizeof(snap.accel));
+    memcpy(snap.gyro, gyro, sizeof(snap.gyro));
+    return write_end(stamp_us);
+}
+
+void snapshot_read(sensor_snapshot_t *out) {
+    uint32_t start;
+    do {
+        while ((start = __atomic_load_n(&seq, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        memcpy(out, &snap, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (start != __atomic_load_n(&seq, __ATOMIC_RELAXED));
+}
+
+uint32_t snapshot_version() { return __atomic_load_n(&seq, __ATOMIC_ACQUIRE) >> 1; }
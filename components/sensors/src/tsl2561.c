@@ -0,0 +1,159 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <driver/i2c.h>
+
+#include "dlog.h"
+#include "i2c_rw.h"
+#include "pipeline.h"
+#include "sampler.h"
+#include "snapshot.h"
+#include "tasks.h"
+#include "tsl2561.h"
+
+#define TAG "TSL2561"
+
+#define TSL2561_ADDR 0x39
+#define SDA 18
+#define SCL 19
+#define PORT I2C_NUM_1
+
+#define CMD 0x80
+#define CMD_WORD 0x20  // read the low and high byte of a channel in one go
+#define REG_CONTROL 0x00
+#define REG_TIMING 0x01
+#define REG_DATA0 0x0c
+#define REG_DATA1 0x0e
+#define POWER_ON 0x03
+#define POWER_OFF 0x00
+#define TIMING_GAIN_16X 0x10
+
+// Most sensitive first. sens is gain times nominal integration time in
+// 0.1 ms, what a count is worth relative to the other ranges. 16x / 13 ms is
+// left out: 1x / 402 ms is more sensitive and spans more light. The last
+// range spans the most and is the quickest, it doubles as the probe.
+typedef struct {
+    tsl2561_gain_t gain;
+    tsl2561_integ_t integ;
+    uint16_t ms;  // nominal integration time
+    uint16_t max;
+    uint32_t sens;
+} range_t;
+
+static const range_t ranges[] = {
+    {TSL2561_GAIN_16X, TSL2561_INTEG_402MS, 402, TSL2561_MAX_402MS, 16 * 4020},
+    {TSL2561_GAIN_16X, TSL2561_INTEG_101MS, 101, TSL2561_MAX_101MS, 16 * 1010},
+    {TSL2561_GAIN_1X, TSL2561_INTEG_402MS, 402, TSL2561_MAX_402MS, 4020},
+    {TSL2561_GAIN_1X, TSL2561_INTEG_101MS, 101, TSL2561_MAX_101MS, 1010},
+    {TSL2561_GAIN_1X, TSL2561_INTEG_13MS, 14, TSL2561_MAX_13MS, 137},
+};
+#define RANGES (sizeof(ranges) / sizeof(ranges[0]))
+#define PROBE (RANGES - 1)
+
+// Hysteresis: leave a range above 80% of its ADC ceiling, move to a more
+// sensitive one only if the reading would land below 40% of its ceiling,
+// so a switch can never make the next reading switch straight back.
+#define DOWN_PERMILLE 800
+#define UP_PERMILLE 400
+
+static tsl2561_counters_t counters;
+
+// i2c_read always clocks in 7 bytes, the buffer has to take them all
+static esp_err_t read_channel(uint8_t reg, uint16_t *out) {
+    uint8_t data[8];
+    esp_err_t err = i2c_read(TSL2561_ADDR, PORT, CMD | CMD_WORD | reg, data);
+    *out = data[0] | data[1] << 8;
+    return err;
+}
+
+static esp_err_t set_range(size_t r) {
+    return i2c_write(TSL2561_ADDR, PORT, CMD | REG_TIMING, (ranges[r].gain ? TIMING_GAIN_16X : 0) | ranges[r].integ);
+}
+
+// Powering up starts a fresh integration, the channels are read as soon as
+// it has completed and the sensor goes back to sleep until the next one.
+static esp_err_t measure(size_t r, uint16_t *ch0, uint16_t *ch1) {
+    esp_err_t err = i2c_write(TSL2561_ADDR, PORT, CMD | REG_CONTROL, POWER_ON);
+    if (err != ESP_OK)
+        return err;
+    // +5% for the oscillator tolerance, +1 tick as the first one may be almost over
+    uint32_t wait_ms = ranges[r].ms + ranges[r].ms / 20 + 1;
+    vTaskDelay((wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS + 1);
+    err = read_channel(REG_DATA0, ch0);
+    if (err == ESP_OK)
+        err = read_channel(REG_DATA1, ch1);
+    i2c_write(TSL2561_ADDR, PORT, CMD | REG_CONTROL, POWER_OFF);
+    return err;
+}
+
+// the most sensitive range the reading in r would fit, peak * sens stays in 32 bits
+static size_t pick_range(size_t r, uint32_t peak) {
+    for (size_t i = 0; i < PROBE; i++) {
+        uint32_t predicted = peak * ranges[i].sens / ranges[r].sens;
+        uint32_t limit = (uint32_t)ranges[i].max * (i < r ? UP_PERMILLE : DOWN_PERMILLE) / 1000;
+        if (predicted < limit)
+            return i;
+    }
+    return PROBE;
+}
+
+static void tsl2561_loop(void *arg) {
+    static sampler_t sampler;
+    size_t r = 0;
+    i2c_init(SDA, SCL, PORT);
+    i2c_write(TSL2561_ADDR, PORT, CMD | REG_CONTROL, POWER_OFF);
+    set_range(r);
+
+    sampler_init(&sampler, "tsl2561", CONFIG_TSL2561_PERIOD_MS, 0);
+    while (1) {
+        sampler_wait(&sampler);
+        // at most two integrations: a saturated reading says nothing about how
+        // far over it is, so it is measured again right away in the probe range
+        for (int tries = 0; tries < 2; tries++) {
+            uint16_t ch0, ch1;
+            esp_err_t err = measure(r, &ch0, &ch1);
+            counters.reads++;
+            if (err != ESP_OK) {
+                counters.errors++;
+                DLOGW(TAG, "Could not read data from sensor (%d)", err);
+                break;
+            }
+            uint32_t peak = ch0 > ch1 ? ch0 : ch1;
+            bool saturated = peak >= ranges[r].max;
+            if (saturated)
+                counters.saturated++;
+            size_t next = saturated ? PROBE : pick_range(r, peak);
+            bool retry = saturated && r != PROBE;
+            if (!retry) {
+                // lux is worked out in the processing stage
+                pipeline_sample_t sample = {
+                    .stamp_us = esp_timer_get_time(),
+                    .value = {ch0, ch1},
+                    .gain = ranges[r].gain,
+                    .integ = ranges[r].integ,
+                };
+                pipeline_submit(PIPELINE_TSL2561, &sample);
+            }
+            if (next != r) {
+                DLOGI(TAG, "range %u: gain %ux, integration %u ms", (unsigned)next, ranges[next].gain ? 16u : 1u,
+                      (unsigned)ranges[next].ms);
+                r = next;
+                counters.range_changes++;
+                set_range(r);
+            }
+            if (!retry)
+                break;
+        }
+    }
+}
+
+void tsl2561_init() { tasks_start(TASK_TSL2561, tsl2561_loop, NULL); }
+
+void tsl2561_get_counters(tsl2561_counters_t *out) { *out = counters; }
+
+float get_lux() {
+    sensor_snapshot_t snap;
+    snapshot_read(&snap);
+    return snap.lux;
+}
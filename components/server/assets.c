@@ -0,0 +1,75 @@
+#include <string.h>
+
+#include "assets.h"
+
+// web_assets.inc is generated by CMakeLists.txt, one ASSET() per file in web/
+#define ASSET(sym, path, type, etag, cache)                                                                                                                    \
+    extern const uint8_t sym##_start[] asm("_binary_" #sym "_start");                                                                                          \
+    extern const uint8_t sym##_end[] asm("_binary_" #sym "_end");
+#include "web_assets.inc"
+#undef ASSET
+
+typedef struct {
+	const char *path;
+	const char *type;
+	const char *etag;
+	const char *cache;
+	const uint8_t *start;
+	const uint8_t *end;
+} asset_t;
+
+static const asset_t assets[] = {
+#define ASSET(sym, path, type, etag, cache) {path, type, etag, cache, sym##_start, sym##_end},
+#include "web_assets.inc"
+#undef ASSET
+};
+
+bool assets_etag_match(httpd_req_t *req, const char *etag) {
+	char list[192];
+	// a list too long for the buffer just gets the full body
+	if (httpd_req_get_hdr_value_str(req, "If-None-Match", list, sizeof(list)) != ESP_OK)
+		return false;
+	size_t etag_len = strlen(etag);
+	for (const char *p = list; *p;) {
+		while (*p == ' ' || *p == '\t' || *p == ',')
+			p++;
+		const char *end = p;
+		while (*end && *end != ',')
+			end++;
+		const char *last = end;
+		while (last > p && (last[-1] == ' ' || last[-1] == '\t'))
+			last--;
+		// weak comparison: a W/ tag from a proxy still names our bytes
+		if (last - p > 2 && p[0] == 'W' && p[1] == '/')
+			p += 2;
+		if ((last - p == 1 && *p == '*') || ((size_t)(last - p) == etag_len && strncmp(p, etag, etag_len) == 0))
+			return true;
+		p = end;
+	}
+	return false;
+}
+
+esp_err_t assets_send(httpd_req_t *req, const char *path, size_t path_len) {
+	const asset_t *asset = NULL;
+	for (size_t i = 0; i < sizeof(assets) / sizeof(assets[0]); i++) {
+		if (strlen(assets[i].path) == path_len && strncmp(assets[i].path, path, path_len) == 0) {
+			asset = &assets[i];
+			break;
+		}
+	}
+	if (asset == NULL)
+		return httpd_resp_send_404(req);
+
+	httpd_resp_set_hdr(req, "ETag", asset->etag);
+	httpd_resp_set_hdr(req, "Cache-Control", asset->cache);
+
+	if (assets_etag_match(req, asset->etag)) {
+		httpd_resp_set_status(req, "304 Not Modified");
+		return httpd_resp_send(req, NULL, 0);
+	}
+
+	httpd_resp_set_type(req, asset->type);
+	httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+	httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+	return httpd_resp_send(req, (const char *)asset->start, asset->end - asset->start);
+}
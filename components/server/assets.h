@@ -0,0 +1,13 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdbool.h>
+#include "esp_http_server.h"
+
+// sends the gzipped asset at path, or a 304 if the client's copy is current
+// If-None-Match against etag (quoted): a comma separated list, "*" and
+// W/ prefixed tags all count
+bool assets_etag_match(httpd_req_t *req, const char *etag);
+esp_err_t assets_send(httpd_req_t *req, const char *path, size_t path_len);
+
+#endif
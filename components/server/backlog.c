@@ -0,0 +1,38 @@
+#include "freertos/FreeRTOS.h"
+
+#include "backlog.h"
+
+#define LEN CONFIG_SERVER_BACKLOG_LEN
+
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static backlog_entry_t ring[LEN];
+static uint32_t last_id = 0;
+
+uint32_t backlog_push(const sensor_snapshot_t *snap) {
+	portENTER_CRITICAL(&lock);
+	// a tick without a new sample would only store a duplicate
+	if (last_id && ring[last_id % LEN].snap.version == snap->version) {
+		portEXIT_CRITICAL(&lock);
+		return last_id;
+	}
+	uint32_t id = ++last_id;
+	ring[id % LEN].id = id;
+	ring[id % LEN].snap = *snap;
+	portEXIT_CRITICAL(&lock);
+	return id;
+}
+
+bool backlog_next(uint32_t after, backlog_entry_t *out) {
+	bool found = false;
+	portENTER_CRITICAL(&lock);
+	uint32_t oldest = last_id > LEN ? last_id - LEN + 1 : 1;
+	uint32_t want = after + 1 > oldest ? after + 1 : oldest;
+	if (want <= last_id) {
+		*out = ring[want % LEN];
+		found = true;
+	}
+	portEXIT_CRITICAL(&lock);
+	return found;
+}
+
+uint32_t backlog_last_id() { return last_id; }
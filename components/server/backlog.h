@@ -0,0 +1,22 @@
+#ifndef BACKLOG_H
+#define BACKLOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "snapshot.h"
+
+// Ring of the last CONFIG_SERVER_BACKLOG_LEN snapshots that had something
+// new, one per pusher tick at most. Ids start at 1 and only grow, so a
+// client can ask for everything after the last id it saw.
+typedef struct {
+	uint32_t id;
+	sensor_snapshot_t snap;
+} backlog_entry_t;
+
+// returns the id of the entry, the last one again if the version is unchanged
+uint32_t backlog_push(const sensor_snapshot_t *snap);
+// oldest entry newer than after, false once the client is caught up
+bool backlog_next(uint32_t after, backlog_entry_t *out);
+uint32_t backlog_last_id();
+
+#endif
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "clock.h"
+#include "dht22.h"
+
+#include "backlog.h"
+#include "export.h"
+#include "workers.h"
+
+#define CHUNK 512
+#define ROW_MAX 96
+
+// sends row[0..n) through chunk, flushing it first when the row doesn't fit
+static esp_err_t add_row(httpd_req_t *req, char *chunk, size_t *len, char *row, int n) {
+	// a long probe name truncates the row rather than overrunning it
+	if (n >= ROW_MAX) {
+		n = ROW_MAX - 1;
+		row[n - 1] = '\n';
+	}
+	if (*len + n > CHUNK) {
+		if (httpd_resp_send_chunk(req, chunk, *len) != ESP_OK)
+			return ESP_FAIL;
+		*len = 0;
+	}
+	memcpy(chunk + *len, row, n);
+	*len += n;
+	return ESP_OK;
+}
+
+static void format_t_ms(int64_t stamp_us, char *out, size_t size) {
+	out[0] = '\0';
+	if (clock_is_set() && stamp_us)
+		snprintf(out, size, "%lld", (long long)(clock_utc_us(stamp_us) / 1000));
+}
+
+// one row per probe and tick, plus one for the light sensor once it has
+// read; each row carries the time its own channel was sampled
+static esp_err_t export_csv(httpd_req_t *req) {
+	char chunk[CHUNK];
+	size_t len = 0;
+	httpd_resp_set_type(req, "text/csv");
+	httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"datalogger.csv\"");
+	len += snprintf(chunk, sizeof(chunk), "id,t_ms,probe,humidity,temperature,lux\n");
+
+	backlog_entry_t entry = {};
+	while (backlog_next(entry.id, &entry)) {
+		char t_ms[24];
+		char row[ROW_MAX];
+		for (size_t i = 0; i < entry.snap.dht_count; i++) {
+			format_t_ms(entry.snap.dht_stamp_us[i], t_ms, sizeof(t_ms));
+			int n = snprintf(row, sizeof(row), "%lu,%s,%s,%.1f,%.1f,\n", (unsigned long)entry.id, t_ms, dht22_probe_name(i),
+							 entry.snap.humidity[i], entry.snap.temperature[i]);
+			if (add_row(req, chunk, &len, row, n) != ESP_OK)
+				return ESP_FAIL;
+		}
+		if (entry.snap.lux_stamp_us) {
+			format_t_ms(entry.snap.lux_stamp_us, t_ms, sizeof(t_ms));
+			int n = snprintf(row, sizeof(row), "%lu,%s,tsl2561,,,%.0f\n", (unsigned long)entry.id, t_ms, entry.snap.lux);
+			if (add_row(req, chunk, &len, row, n) != ESP_OK)
+				return ESP_FAIL;
+		}
+	}
+	if (len && httpd_resp_send_chunk(req, chunk, len) != ESP_OK)
+		return ESP_FAIL;
+	return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t uri_export(httpd_req_t *req) { return workers_submit(req, export_csv); }
+
+void export_init(httpd_handle_t server) {
+	httpd_uri_t export_uri = {
+		.uri = "/api/export",
+		.method = HTTP_GET,
+		.handler = uri_export,
+	};
+	httpd_register_uri_handler(server, &export_uri);
+}
@@ -0,0 +1,9 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "esp_http_server.h"
+
+// registers /api/export, the backlog as CSV, streamed from a worker
+void export_init(httpd_handle_t server);
+
+#endif
@@ -0,0 +1,8 @@
+#!/usr/bin/env python3
+"""gzip one web asset reproducibly: no name and a zero mtime in the header."""
+import gzip
+import sys
+
+with open(sys.argv[1], "rb") as src, open(sys.argv[2], "wb") as out:
+    with gzip.GzipFile(filename="", mode="wb", fileobj=out, compresslevel=9, mtime=0) as gz:
+        gz.write(src.read())
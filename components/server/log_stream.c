@@ -0,0 +1,253 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "log_stream.h"
+#include "tasks.h"
+#include "ws_clients.h"
+
+#define LINES CONFIG_SERVER_LOG_LINES
+#define LINE_MAX 128
+#define MAX_VIEWERS 2
+#define LOG_FLUSH_MS 250
+// per viewer and flush, so a chatty log can't crowd out the telemetry
+#define FRAME_MAX 1024
+
+#ifdef CONFIG_SERVER_LOG_HISTORY
+#define KEEP_HISTORY true
+#else
+#define KEEP_HISTORY false
+#endif
+
+typedef struct {
+	uint32_t seq;
+	uint8_t len;
+	char text[LINE_MAX];
+} line_t;
+
+typedef struct {
+	int fd;  // -1 when free
+	uint32_t cursor;  // seq of the next line to send
+	char level;  // most verbose level letter wanted
+	char tag[16];  // empty for every tag
+} viewer_t;
+
+// the ring is written by any task that logs
+static line_t ring[LINES];
+static uint32_t next_seq = 1;
+static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+static vprintf_like_t uart_vprintf;
+static bool hooked;
+// shared by every logging task so none of them carries a line on its stack;
+// a mutex rather than ring_lock, vsnprintf may allocate and takes too long
+// to run with interrupts off
+static char scratch[LINE_MAX];
+static SemaphoreHandle_t scratch_lock;
+static StaticSemaphore_t scratch_lock_buf;
+static TaskHandle_t pump;
+
+// httpd task only
+static viewer_t viewers[MAX_VIEWERS] = {[0 ... MAX_VIEWERS - 1] = {.fd = -1}};
+static size_t viewer_count;
+static char frame[FRAME_MAX];
+static volatile bool flush_queued;
+static httpd_handle_t httpd;
+
+static int log_hook(const char *fmt, va_list args) {
+	// the scheduler must be running to wait for the mutex, early lines only reach the UART
+	if (xPortInIsrContext() || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+		return uart_vprintf(fmt, args);
+
+	xSemaphoreTake(scratch_lock, portMAX_DELAY);
+	va_list copy;
+	va_copy(copy, args);
+	int n = vsnprintf(scratch, sizeof(scratch), fmt, copy);
+	va_end(copy);
+	// a long line is kept truncated, the escape skip must not run past it
+	if (n >= (int)sizeof(scratch))
+		n = sizeof(scratch) - 1;
+
+	// drop the color escapes, keep one line without the newline
+	size_t len = 0;
+	for (int i = 0; i < n; i++) {
+		if (scratch[i] == '\033') {
+			while (i < n && scratch[i] != 'm')
+				i++;
+			continue;
+		}
+		if (scratch[i] != '\n' && scratch[i] != '\r')
+			scratch[len++] = scratch[i];
+	}
+	if (len) {
+		portENTER_CRITICAL(&ring_lock);
+		line_t *line = &ring[next_seq % LINES];
+		line->seq = next_seq++;
+		line->len = len;
+		memcpy(line->text, scratch, len);
+		portEXIT_CRITICAL(&ring_lock);
+	}
+	xSemaphoreGive(scratch_lock);
+	if (len && viewer_count)
+		xTaskNotifyGive(pump);
+	return uart_vprintf(fmt, args);
+}
+
+static void hook(bool on) {
+	if (on == hooked)
+		return;
+	hooked = on;
+	if (on)
+		uart_vprintf = esp_log_set_vprintf(log_hook);
+	else
+		esp_log_set_vprintf(uart_vprintf);
+}
+
+// "W (1234) TAG: ..." as printed by esp_log; lines that don't look like it pass every filter
+static bool wanted(const viewer_t *v, const char *text, size_t len) {
+	static const char order[] = "EWIDV";
+	const char *rank = len ? strchr(order, text[0]) : NULL;
+	if (rank == NULL)
+		return true;
+	if (rank > strchr(order, v->level))
+		return false;
+	if (v->tag[0] == '\0')
+		return true;
+	const char *tag = memchr(text, ')', len);
+	if (tag == NULL || tag + 2 >= text + len)
+		return true;
+	tag += 2;
+	size_t tag_len = strlen(v->tag);
+	return (size_t)(text + len - tag) > tag_len && memcmp(tag, v->tag, tag_len) == 0 && tag[tag_len] == ':';
+}
+
+static void viewer_drop(viewer_t *v) {
+	v->fd = -1;
+	if (--viewer_count == 0 && !KEEP_HISTORY)
+		hook(false);
+}
+
+// one frame of newline separated lines per viewer
+static void log_flush(void *arg) {
+	flush_queued = false;
+	bool more = false;
+	for (size_t i = 0; i < MAX_VIEWERS; i++) {
+		viewer_t *v = &viewers[i];
+		if (v->fd < 0)
+			continue;
+		if (ws_clients_kind(v->fd) != WS_KIND_LOG) {
+			// closed, maybe already reused by another client
+			viewer_drop(v);
+			continue;
+		}
+
+		size_t len = 0;
+		uint32_t end = next_seq;
+		if (end - v->cursor > LINES) {
+			len += snprintf(frame, sizeof(frame), "... %lu lines lost\n", (unsigned long)(end - LINES - v->cursor));
+			v->cursor = end - LINES;
+		}
+		while (v->cursor != end) {
+			line_t line;
+			portENTER_CRITICAL(&ring_lock);
+			line = ring[v->cursor % LINES];
+			portEXIT_CRITICAL(&ring_lock);
+			if (line.seq != v->cursor) {
+				// overwritten since end was read, catch up next time
+				break;
+			}
+			if (wanted(v, line.text, line.len)) {
+				if (len + line.len + 1 > sizeof(frame))
+					break;
+				memcpy(frame + len, line.text, line.len);
+				len += line.len;
+				frame[len++] = '\n';
+			}
+			v->cursor++;
+		}
+		if (v->cursor != end)
+			more = true;
+		if (len == 0)
+			continue;
+		httpd_ws_frame_t pkt = {.type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t *)frame, .len = len};
+		if (httpd_ws_send_frame_async(httpd, v->fd, &pkt) != ESP_OK)
+			viewer_drop(v);
+	}
+	// the frame filled up or the ring moved on, go again without waiting for a new line
+	if (more)
+		xTaskNotifyGive(pump);
+}
+
+// sleeps until log_hook or a new viewer has something to send
+static void log_pump(void *arg) {
+	while (1) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		// let a burst of lines collect into one frame
+		vTaskDelay(pdMS_TO_TICKS(LOG_FLUSH_MS));
+		if (viewer_count == 0 || flush_queued)
+			continue;
+		flush_queued = true;
+		if (httpd_queue_work(httpd, log_flush, NULL) != ESP_OK) {
+			flush_queued = false;
+			xTaskNotifyGive(pump);
+		}
+	}
+}
+
+static void query_value(httpd_req_t *req, const char *key, char *out, size_t size) {
+	char query[64];
+	out[0] = '\0';
+	if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+		httpd_query_key_value(query, key, out, size);
+}
+
+static esp_err_t uri_log(httpd_req_t *req) {
+	if (req->method == HTTP_GET) {
+		viewer_t *v = NULL;
+		for (size_t i = 0; i < MAX_VIEWERS && !v; i++) {
+			if (viewers[i].fd < 0)
+				v = &viewers[i];
+		}
+		if (v == NULL || ws_clients_admit(req, WS_KIND_LOG) != ESP_OK)
+			return ESP_FAIL;
+
+		char level[4];
+		query_value(req, "level", level, sizeof(level));
+		v->level = level[0] && strchr("EWIDV", level[0]) ? level[0] : 'V';
+		query_value(req, "tag", v->tag, sizeof(v->tag));
+		v->fd = httpd_req_to_sockfd(req);
+		// start with whatever the ring still holds
+		v->cursor = next_seq > LINES ? next_seq - LINES : 1;
+		viewer_count++;
+		hook(true);
+		xTaskNotifyGive(pump);
+		return ESP_OK;
+	}
+
+	uint8_t buf[128];
+	httpd_ws_frame_t frame;
+	// viewers have nothing to say, an oversized frame is just dropped
+	esp_err_t err = ws_clients_recv(req, &frame, buf, sizeof(buf));
+	return err == ESP_ERR_INVALID_SIZE ? ESP_OK : err;
+}
+
+void log_stream_init(httpd_handle_t server) {
+	httpd = server;
+	scratch_lock = xSemaphoreCreateMutexStatic(&scratch_lock_buf);
+	pump = tasks_start(TASK_LOG_PUMP, log_pump, NULL);
+	if (KEEP_HISTORY)
+		hook(true);
+
+	httpd_uri_t log_uri = {
+		.uri = "/ws/log",
+		.method = HTTP_GET,
+		.handler = uri_log,
+		.is_websocket = true,
+		.handle_ws_control_frames = true,
+	};
+	httpd_register_uri_handler(server, &log_uri);
+}
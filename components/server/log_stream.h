@@ -0,0 +1,12 @@
+#ifndef LOG_STREAM_H
+#define LOG_STREAM_H
+
+#include "esp_http_server.h"
+
+// Registers /ws/log?level=W&tag=DHT22 (both optional): the device log,
+// starting with what is still in the RAM ring. New lines wake the pump, which
+// waits LOG_FLUSH_MS and sends them as one frame per client. The esp_log hook is only installed while a
+// viewer is connected unless CONFIG_SERVER_LOG_HISTORY keeps it on.
+void log_stream_init(httpd_handle_t server);
+
+#endif
@@ -0,0 +1,92 @@
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht22.h"
+#include "sampler.h"
+#include "snapshot.h"
+
+#include "metrics.h"
+#include "resp_writer.h"
+
+#define PREFIX "datalogger_"
+
+// httpd task only, reused by every scrape
+static char buf[1024];
+
+static void family(resp_writer_t *w, const char *name, const char *type, const char *help) {
+	resp_writer_printf(w, "# HELP " PREFIX "%s %s\n# TYPE " PREFIX "%s %s\n", name, help, name, type);
+}
+
+static esp_err_t uri_metrics(httpd_req_t *req) {
+	resp_writer_t w;
+	resp_writer_init(&w, req, buf, sizeof(buf));
+	httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+	sensor_snapshot_t snap;
+	snapshot_read(&snap);
+	family(&w, "humidity_percent", "gauge", "Relative humidity.");
+	for (size_t i = 0; i < snap.dht_count; i++)
+		resp_writer_printf(&w, PREFIX "humidity_percent{probe=\"%s\"} %.1f\n", dht22_probe_name(i), snap.humidity[i]);
+	family(&w, "temperature_celsius", "gauge", "Temperature.");
+	for (size_t i = 0; i < snap.dht_count; i++)
+		resp_writer_printf(&w, PREFIX "temperature_celsius{probe=\"%s\"} %.1f\n", dht22_probe_name(i), snap.temperature[i]);
+	if (snap.lux_stamp_us) {
+		family(&w, "illuminance_lux", "gauge", "Illuminance from the TSL2561.");
+		resp_writer_printf(&w, PREFIX "illuminance_lux %.0f\n", snap.lux);
+	}
+	family(&w, "sample_age_seconds", "gauge", "Time since the newest sample.");
+	resp_writer_printf(&w, PREFIX "sample_age_seconds %.3f\n", snap.stamp_us ? (esp_timer_get_time() - snap.stamp_us) / 1e6 : 0.0);
+
+	family(&w, "dht_reads_total", "counter", "DHT22 read attempts.");
+	for (size_t i = 0; i < dht22_probe_count(); i++) {
+		dht22_counters_t c;
+		dht22_get_counters(i, &c);
+		resp_writer_printf(&w, PREFIX "dht_reads_total{probe=\"%s\"} %lu\n", dht22_probe_name(i), (unsigned long)c.reads);
+	}
+	family(&w, "dht_errors_total", "counter", "Failed DHT22 reads by cause.");
+	for (size_t i = 0; i < dht22_probe_count(); i++) {
+		dht22_counters_t c;
+		dht22_get_counters(i, &c);
+		const char *name = dht22_probe_name(i);
+		resp_writer_printf(&w,
+						   PREFIX "dht_errors_total{probe=\"%s\",kind=\"timeout\"} %lu\n" PREFIX "dht_errors_total{probe=\"%s\",kind=\"checksum\"} %lu\n" PREFIX
+								  "dht_errors_total{probe=\"%s\",kind=\"other\"} %lu\n",
+						   name, (unsigned long)c.timeouts, name, (unsigned long)c.checksum_errors, name, (unsigned long)c.other_errors);
+	}
+
+	family(&w, "sampler_overruns_total", "counter", "Missed sampling deadlines since boot.");
+	for (size_t i = 0; i < sampler_count(); i++) {
+		const sampler_t *s = sampler_get(i);
+		resp_writer_printf(&w, PREFIX "sampler_overruns_total{channel=\"%s\"} %lu\n", s->name, (unsigned long)s->overruns_total);
+	}
+
+	family(&w, "heap_free_bytes", "gauge", "Free internal heap.");
+	resp_writer_printf(&w, PREFIX "heap_free_bytes %u\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT));
+	family(&w, "heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+	resp_writer_printf(&w, PREFIX "heap_min_free_bytes %u\n", (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+	family(&w, "heap_largest_block_bytes", "gauge", "Largest allocatable block.");
+	resp_writer_printf(&w, PREFIX "heap_largest_block_bytes %u\n", (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+	family(&w, "tasks", "gauge", "FreeRTOS tasks.");
+	resp_writer_printf(&w, PREFIX "tasks %u\n", (unsigned)uxTaskGetNumberOfTasks());
+	family(&w, "uptime_seconds", "counter", "Time since boot.");
+	resp_writer_printf(&w, PREFIX "uptime_seconds %lld\n", (long long)(esp_timer_get_time() / 1000000));
+
+	wifi_ap_record_t ap;
+	if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+		family(&w, "wifi_rssi_dbm", "gauge", "Signal of the access point.");
+		resp_writer_printf(&w, PREFIX "wifi_rssi_dbm %d\n", ap.rssi);
+	}
+	return resp_writer_finish(&w);
+}
+
+void metrics_init(httpd_handle_t server) {
+	httpd_uri_t metrics_uri = {
+		.uri = "/metrics",
+		.method = HTTP_GET,
+		.handler = uri_metrics,
+	};
+	httpd_register_uri_handler(server, &metrics_uri);
+}
@@ -0,0 +1,9 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "esp_http_server.h"
+
+// registers /metrics, Prometheus text format
+void metrics_init(httpd_handle_t server);
+
+#endif
@@ -0,0 +1,46 @@
+#include <stdio.h>
+
+#include "clock.h"
+#include "dht22.h"
+#include "payload.h"
+#include "snapshot.h"
+#include "trace.h"
+
+static payload_t cached = {.version = UINT32_MAX};
+
+#define APPEND(...)                                                                                                                                            \
+	do {                                                                                                                                                       \
+		if (len < size)                                                                                                                                        \
+			len += snprintf(buf + len, size - len, __VA_ARGS__);                                                                                               \
+	} while (0)
+
+size_t payload_format(const sensor_snapshot_t *snap, char *buf, size_t size) {
+	size_t len = 0;
+	APPEND("{\"version\":%lu,\"humidity\":%.1f,\"temperature\":%.1f", (unsigned long)snap->version, snap->humidity[0], snap->temperature[0]);
+	if (clock_is_set())
+		APPEND(",\"t\":%lld", (long long)(clock_utc_us(snap->stamp_us) / 1000));
+	// device clock, only good for echoing back (see the "rendered" command)
+	APPEND(",\"stamp_us\":%lld", (long long)snap->stamp_us);
+	APPEND(",\"probes\":[");
+	for (size_t i = 0; i < snap->dht_count; i++) {
+		APPEND("%s{\"name\":\"%s\",\"humidity\":%.1f,\"temperature\":%.1f}", i ? "," : "", dht22_probe_name(i), snap->humidity[i], snap->temperature[i]);
+	}
+	APPEND("]");
+	if (snap->lux_stamp_us)
+		APPEND(",\"lux\":%.0f", snap->lux);
+	APPEND("}");
+	return len < size ? len : size - 1;
+}
+
+const payload_t *payload_latest() {
+	if (snapshot_version() != cached.version) {
+		sensor_snapshot_t snap;
+		snapshot_read(&snap);
+		TRACE_BEGIN("serialize");
+		cached.len = payload_format(&snap, cached.json, sizeof(cached.json));
+		TRACE_END("serialize");
+		cached.version = snap.version;
+		cached.stamp_us = snap.stamp_us;
+	}
+	return &cached;
+}
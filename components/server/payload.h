@@ -0,0 +1,24 @@
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "snapshot.h"
+
+#define PAYLOAD_MAX 1024
+
+typedef struct {
+	uint32_t version;  // snapshot version it was built from
+	int64_t stamp_us;  // acquisition time of its newest sample
+	size_t len;
+	char json[PAYLOAD_MAX];
+} payload_t;
+
+// serializes any snapshot (e.g. one from the backlog), returns the length
+size_t payload_format(const sensor_snapshot_t *snap, char *buf, size_t size);
+
+// JSON of the latest snapshot, only re-serialized when the snapshot version
+// moved. Not thread safe: call it from the httpd task (handlers, queued work).
+const payload_t *payload_latest();
+
+#endif
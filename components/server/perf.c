@@ -0,0 +1,178 @@
+#include <string.h>
+
+#include "esp_timer.h"
+
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht22.h"
+#include "heapacct.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "tasks.h"
+
+#include "perf.h"
+#include "resp_writer.h"
+#include "server.h"
+
+#define MAX_TASKS 32
+
+// everything below is only touched from the httpd task
+static char buf[1024];
+static TaskStatus_t tasks[MAX_TASKS];
+static stats_hist_t ws_send_hist;
+static stats_hist_t sent_age_hist;
+static stats_hist_t rendered_age_hist;
+
+// run time counters of the previous report, CPU share is over the interval
+static struct {
+	UBaseType_t number;
+	configRUN_TIME_COUNTER_TYPE runtime;
+} prev[MAX_TASKS];
+static size_t prev_count;
+static configRUN_TIME_COUNTER_TYPE prev_total;
+
+void perf_ws_send(uint32_t us) { stats_hist_record(&ws_send_hist, us); }
+
+static void record_age(stats_hist_t *h, int64_t stamp_us) {
+	int64_t age = esp_timer_get_time() - stamp_us;
+	if (stamp_us > 0 && age >= 0)
+		stats_hist_record(h, age > UINT32_MAX ? UINT32_MAX : (uint32_t)age);
+}
+
+void perf_sample_sent(int64_t stamp_us) { record_age(&sent_age_hist, stamp_us); }
+
+void perf_sample_rendered(int64_t stamp_us) { record_age(&rendered_age_hist, stamp_us); }
+
+static configRUN_TIME_COUNTER_TYPE prev_runtime(UBaseType_t number) {
+	for (size_t i = 0; i < prev_count; i++) {
+		if (prev[i].number == number)
+			return prev[i].runtime;
+	}
+	return 0;
+}
+
+static void hist(resp_writer_t *w, const char *name, const stats_hist_t *h) {
+	resp_writer_printf(w, "\"%s\":{\"count\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}", name, (unsigned long)h->count,
+					   (unsigned long)stats_hist_percentile(h, 500), (unsigned long)stats_hist_percentile(h, 990), (unsigned long)h->max);
+}
+
+// ?reset=1 clears the histograms after the report
+static esp_err_t uri_perf(httpd_req_t *req) {
+	char query[32];
+	bool reset = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && strstr(query, "reset=1");
+	resp_writer_t w;
+	resp_writer_init(&w, req, buf, sizeof(buf));
+	httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+
+	configRUN_TIME_COUNTER_TYPE total;
+	UBaseType_t count = uxTaskGetSystemState(tasks, MAX_TASKS, &total);
+	// every core accrues run time, the idle tasks included
+	configRUN_TIME_COUNTER_TYPE elapsed = (total - prev_total) * portNUM_PROCESSORS;
+
+	resp_writer_printf(&w, "{\"tasks\":[");
+	for (UBaseType_t i = 0; i < count; i++) {
+		const TaskStatus_t *t = &tasks[i];
+		configRUN_TIME_COUNTER_TYPE ran = t->ulRunTimeCounter - prev_runtime(t->xTaskNumber);
+		// stack is 0 for tasks outside the task table (httpd, wifi, idle...)
+		resp_writer_printf(&w, "%s{\"name\":\"%s\",\"prio\":%u,\"cpu\":%.1f,\"stack\":%lu,\"stack_free\":%lu}", i ? "," : "",
+						   t->pcTaskName, (unsigned)t->uxCurrentPriority, elapsed ? 100.0 * ran / elapsed : 0.0,
+						   (unsigned long)tasks_stack_size(t->xHandle), (unsigned long)t->usStackHighWaterMark);
+	}
+	if (count == 0)
+		resp_writer_printf(&w, "],\"tasks_truncated\":true");
+	else
+		resp_writer_printf(&w, "]");
+
+	for (prev_count = 0; prev_count < count; prev_count++) {
+		prev[prev_count].number = tasks[prev_count].xTaskNumber;
+		prev[prev_count].runtime = tasks[prev_count].ulRunTimeCounter;
+	}
+	prev_total = total;
+
+	resp_writer_printf(&w, ",\"heap\":{\"free\":%u,\"min_free\":%u,\"largest_block\":%u},", (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+					   (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT), (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+	hist(&w, "dht_read_us", dht22_read_hist());
+	resp_writer_printf(&w, ",");
+	hist(&w, "ws_send_us", &ws_send_hist);
+	resp_writer_printf(&w, ",");
+	hist(&w, "sample_to_send_us", &sent_age_hist);
+	resp_writer_printf(&w, ",");
+	hist(&w, "sample_to_render_us", &rendered_age_hist);
+	pipeline_stats_t ps;
+	pipeline_get_stats(&ps);
+	resp_writer_printf(&w, ",\"pipeline\":{\"submitted\":%lu,\"dropped\":%lu,\"processed\":%lu,\"events_dropped\":%lu,", (unsigned long)ps.submitted,
+					   (unsigned long)ps.dropped, (unsigned long)ps.processed, (unsigned long)ps.events_dropped);
+	hist(&w, "latency_us", pipeline_latency_hist());
+	server_push_stats_t push;
+	server_push_stats(&push);
+	resp_writer_printf(&w, "},\"push\":{\"ticks\":%lu,\"heap_changed\":%lu,\"last_heap_delta\":%ld,\"skipped\":%lu,\"queue_failed\":%lu}}",
+					   (unsigned long)push.ticks, (unsigned long)push.heap_changed, (long)push.last_heap_delta, (unsigned long)push.skipped,
+					   (unsigned long)push.queue_failed);
+	if (reset) {
+		stats_hist_reset(pipeline_latency_hist());
+		stats_hist_reset(&ws_send_hist);
+		stats_hist_reset(&sent_age_hist);
+		stats_hist_reset(&rendered_age_hist);
+	}
+	return resp_writer_finish(&w);
+}
+
+// Heap per task and the busiest allocation sites. Rates are over the time
+// since the previous request; ?check=1 answers 500 when a task allocates
+// faster than CONFIG_HEAPACCT_RATE_BUDGET, for monitoring to alert on.
+static esp_err_t uri_heap(httpd_req_t *req) {
+	static heapacct_task_t stats[HEAPACCT_MAX_TASKS];
+	static heapacct_site_t sites[HEAPACCT_MAX_SITES];
+	static uint32_t prev_allocs[HEAPACCT_MAX_TASKS];
+	static int64_t prev_us;
+
+	char query[32];
+	bool check = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && strstr(query, "check=1");
+	int64_t now_us = esp_timer_get_time();
+	uint32_t elapsed_ms = (now_us - prev_us) / 1000;
+	prev_us = now_us;
+	size_t n = heapacct_tasks(stats, HEAPACCT_MAX_TASKS);
+
+	bool over = false;
+	resp_writer_t w;
+	resp_writer_init(&w, req, buf, sizeof(buf));
+	resp_writer_printf(&w, "{\"untracked\":%lu,\"tasks\":[", (unsigned long)heapacct_untracked());
+	for (size_t i = 0; i < n; i++) {
+		uint32_t rate = elapsed_ms ? (uint64_t)(stats[i].allocs - prev_allocs[i]) * 1000 / elapsed_ms : 0;
+		prev_allocs[i] = stats[i].allocs;
+		if (CONFIG_HEAPACCT_RATE_BUDGET && rate > CONFIG_HEAPACCT_RATE_BUDGET)
+			over = true;
+		resp_writer_printf(&w, "%s{\"name\":\"%s\",\"live\":%u,\"peak\":%u,\"allocs\":%lu,\"frees\":%lu,\"allocs_per_s\":%lu}", i ? "," : "",
+						   stats[i].name, (unsigned)stats[i].live, (unsigned)stats[i].peak, (unsigned long)stats[i].allocs,
+						   (unsigned long)stats[i].frees, (unsigned long)rate);
+	}
+	resp_writer_printf(&w, "],\"sites\":[");
+	size_t m = heapacct_sites(sites, HEAPACCT_MAX_SITES);
+	for (size_t i = 0; i < m; i++)
+		resp_writer_printf(&w, "%s{\"pc\":\"0x%08lx\",\"allocs\":%lu,\"bytes\":%lu}", i ? "," : "", (unsigned long)sites[i].pc,
+						   (unsigned long)sites[i].allocs, (unsigned long)sites[i].bytes);
+	resp_writer_printf(&w, "],\"over_budget\":%s}", over ? "true" : "false");
+
+	// the status goes out with the first chunk, so it has to be known by now
+	if (check && over)
+		httpd_resp_set_status(req, HTTPD_500);
+	httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+	return resp_writer_finish(&w);
+}
+
+void perf_init(httpd_handle_t server) {
+	httpd_uri_t perf_uri = {
+		.uri = "/debug/perf",
+		.method = HTTP_GET,
+		.handler = uri_perf,
+	};
+	httpd_register_uri_handler(server, &perf_uri);
+	httpd_uri_t heap_uri = {
+		.uri = "/debug/heap",
+		.method = HTTP_GET,
+		.handler = uri_heap,
+	};
+	httpd_register_uri_handler(server, &heap_uri);
+}
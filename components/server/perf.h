@@ -0,0 +1,19 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include "esp_http_server.h"
+
+// registers /debug/perf: CPU share and stack headroom of every task, heap,
+// the read/send latency histograms and the heap check of the push ticks;
+// and /debug/heap, heap per task
+void perf_init(httpd_handle_t server);
+// httpd task only:
+// time one websocket frame took to send
+void perf_ws_send(uint32_t us);
+// a sample acquired at stamp_us (esp_timer) just went out to a client
+void perf_sample_sent(int64_t stamp_us);
+// a dashboard echoed stamp_us back after drawing it; includes the trip back
+void perf_sample_rendered(int64_t stamp_us);
+
+#endif
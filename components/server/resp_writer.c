@@ -0,0 +1,44 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "resp_writer.h"
+
+static void flush(resp_writer_t *w) {
+	if (w->len && w->err == ESP_OK)
+		w->err = httpd_resp_send_chunk(w->req, w->buf, w->len);
+	w->len = 0;
+}
+
+void resp_writer_init(resp_writer_t *w, httpd_req_t *req, char *buf, size_t size) {
+	*w = (resp_writer_t){.req = req, .buf = buf, .size = size, .err = ESP_OK};
+}
+
+void resp_writer_printf(resp_writer_t *w, const char *fmt, ...) {
+	for (int attempt = 0; attempt < 2 && w->err == ESP_OK; attempt++) {
+		va_list args;
+		va_start(args, fmt);
+		int n = vsnprintf(w->buf + w->len, w->size - w->len, fmt, args);
+		va_end(args);
+		if (n < 0)
+			return;
+		if (w->len + n < w->size) {
+			w->len += n;
+			return;
+		}
+		if (w->len == 0) {
+			// longer than the whole buffer, the tail is lost
+			w->len = w->size - 1;
+			flush(w);
+			return;
+		}
+		// didn't fit behind what is already there: send that and retry
+		flush(w);
+	}
+}
+
+esp_err_t resp_writer_finish(resp_writer_t *w) {
+	flush(w);
+	if (w->err != ESP_OK)
+		return w->err;
+	return httpd_resp_send_chunk(w->req, NULL, 0);
+}
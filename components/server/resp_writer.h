@@ -0,0 +1,22 @@
+#ifndef RESP_WRITER_H
+#define RESP_WRITER_H
+
+#include <stddef.h>
+#include "esp_http_server.h"
+
+// printf into a caller owned buffer that goes out as a chunk whenever it
+// fills up, so a report of any length needs neither heap nor a big stack
+typedef struct {
+	httpd_req_t *req;
+	char *buf;
+	size_t size;
+	size_t len;
+	esp_err_t err;  // first send error, later writes are dropped
+} resp_writer_t;
+
+void resp_writer_init(resp_writer_t *w, httpd_req_t *req, char *buf, size_t size);
+void resp_writer_printf(resp_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+// flushes the rest and ends the chunked response
+esp_err_t resp_writer_finish(resp_writer_t *w);
+
+#endif
@@ -2,119 +2,267 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "esp_heap_caps.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/task.h"
 #include "mdns.h"
-#include "dht22.h"
+#include "dlog.h"
+#include "pipeline.h"
+#include "sampler.h"
+#include "snapshot.h"
 #include "server.h"
-#include "cJSON.h"
+#include "assets.h"
+#include "backlog.h"
+#include "payload.h"
+#include "sse.h"
+#include "ws_clients.h"
+#include "workers.h"
+#include "ws_cmd.h"
+#include "metrics.h"
+#include "perf.h"
+#include "log_stream.h"
+#include "trace_http.h"
+#include "trace.h"
+#include "tasks.h"
+#include "export.h"
 
 static const char *TAG = "HTTPD SERVER";
 
-extern const char html[] asm("_binary_index_html_start");
+// commands are small, control frames are at most 125 bytes
+#define WS_RX_MAX 256
 
-uint8_t time_data[] = {};
+#define PUSH_PERIOD_MS 10000
+
+_Static_assert(CONFIG_SERVER_MAX_OPEN_SOCKETS <= CONFIG_LWIP_MAX_SOCKETS - 3, "httpd needs 3 of the LWIP sockets for itself");
 
 struct async_resp_arg {
 	httpd_handle_t hd;
 	int fd;
 };
 
+// One descriptor per websocket slot, borrowed by the pusher and given back
+// by send_data, so a push tick never touches the heap. All clients send
+// straight from the shared payload cache.
+static struct async_resp_arg resp_pool[WS_CLIENTS_MAX];
+static uint32_t resp_busy;
+static portMUX_TYPE resp_lock = portMUX_INITIALIZER_UNLOCKED;
+
+_Static_assert(WS_CLIENTS_MAX <= 32, "resp_busy is a 32 bit mask");
+
+static volatile bool capture;
+static TaskHandle_t pusher;
+// written by the pusher only, read by /debug/perf
+static server_push_stats_t push_stats;
+
 static esp_err_t uri_home(httpd_req_t *req);
+static esp_err_t uri_static(httpd_req_t *req);
 static esp_err_t ws_handler(httpd_req_t *req);
+static esp_err_t uri_jitter(httpd_req_t *req);
+static esp_err_t uri_latest(httpd_req_t *req);
+static struct async_resp_arg *resp_borrow();
+static void resp_return(struct async_resp_arg *arg);
 static void send_data(void *arg) ;
 static void ws_server_send_messages(void *serverd);
+static void ws_keepalive_work(void *server);
+static void ws_keepalive_timer(void *server);
 
 // setup for the home page
 static esp_err_t uri_home(httpd_req_t *req) {
-	ESP_LOGI(TAG, "uri_handler is starting\n");
-	httpd_resp_sendstr(req, html);
-	return ESP_OK;
+	DLOGI(TAG, "uri_handler is starting");
+	return assets_send(req, "/index.html", strlen("/index.html"));
+}
+
+// everything else under / is looked up in the embedded web/ assets
+static esp_err_t uri_static(httpd_req_t *req) {
+	return assets_send(req, req->uri, strcspn(req->uri, "?"));
 }
 
 static esp_err_t ws_handler(httpd_req_t *req) {
 	if (req->method == HTTP_GET) {
-		ESP_LOGI(TAG, "Handshake done, the new connection was opened");
-		return ESP_OK;
+		if (ws_clients_admit(req, WS_KIND_DASHBOARD) != ESP_OK)
+			return ESP_FAIL;
+		DLOGI(TAG, "Handshake done, the new connection was opened");
+		// the chart starts from the history instead of waiting for the next push
+		return ws_send_backlog(req->handle, httpd_req_to_sockfd(req), 0, -1);
 	}
+
+	uint8_t buf[WS_RX_MAX];
+	httpd_ws_frame_t frame;
+	esp_err_t err = ws_clients_recv(req, &frame, buf, sizeof(buf));
+	if (err == ESP_ERR_INVALID_SIZE)
+		return ws_cmd_too_long(req, sizeof(buf));
+	if (err != ESP_OK)
+		return ESP_FAIL;
+	if (frame.type == HTTPD_WS_TYPE_TEXT)
+		return ws_cmd_dispatch(req, (const char *)buf, frame.len);
 	return ESP_OK;
 }
 
+static void ws_keepalive_work(void *server) { ws_clients_keepalive(server); }
+
+static void ws_keepalive_timer(void *server) { httpd_queue_work(server, ws_keepalive_work, server); }
+
+// sampling jitter of every acquisition channel, in microseconds;
+// ?reset=1 starts a new measurement window after the report
+static esp_err_t uri_jitter(httpd_req_t *req) {
+	char line[160];
+	bool reset = httpd_req_get_url_query_str(req, line, sizeof(line)) == ESP_OK && strstr(line, "reset=1");
+	httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+	httpd_resp_sendstr_chunk(req, "[");
+	for (size_t i = 0; i < sampler_count(); i++) {
+		const sampler_t *s = sampler_get(i);
+		snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"count\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu,\"overruns\":%lu}",
+				 i ? "," : "", s->name, (unsigned long)s->jitter.count, (unsigned long)stats_hist_percentile(&s->jitter, 500),
+				 (unsigned long)stats_hist_percentile(&s->jitter, 990), (unsigned long)s->jitter.max, (unsigned long)s->overruns);
+		httpd_resp_sendstr_chunk(req, line);
+	}
+	httpd_resp_sendstr_chunk(req, "]");
+	if (reset)
+		sampler_reset_stats();
+	return httpd_resp_sendstr_chunk(req, NULL);
+}
+
+// Latest snapshot for HTTP pollers. The snapshot version is the ETag, so a
+// poller that is already current gets a 304 before anything is serialized.
+static esp_err_t uri_latest(httpd_req_t *req) {
+	char etag[16];
+	snprintf(etag, sizeof(etag), "\"%lu\"", (unsigned long)snapshot_version());
+	httpd_resp_set_hdr(req, "ETag", etag);
+	httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+	if (assets_etag_match(req, etag)) {
+		httpd_resp_set_status(req, "304 Not Modified");
+		return httpd_resp_send(req, NULL, 0);
+	}
+
+	const payload_t *payload = payload_latest();
+	// a sample may have landed in between, the body must match its tag
+	snprintf(etag, sizeof(etag), "\"%lu\"", (unsigned long)payload->version);
+	httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+	return httpd_resp_send(req, payload->json, payload->len);
+}
+
+static struct async_resp_arg *resp_borrow() {
+	struct async_resp_arg *arg = NULL;
+	portENTER_CRITICAL(&resp_lock);
+	for (size_t i = 0; i < WS_CLIENTS_MAX && !arg; i++) {
+		if (!(resp_busy & (1u << i))) {
+			resp_busy |= 1u << i;
+			arg = &resp_pool[i];
+		}
+	}
+	portEXIT_CRITICAL(&resp_lock);
+	return arg;
+}
+
+static void resp_return(struct async_resp_arg *arg) {
+	portENTER_CRITICAL(&resp_lock);
+	resp_busy &= ~(1u << (arg - resp_pool));
+	portEXIT_CRITICAL(&resp_lock);
+}
+
 static void send_data(void *arg) {
 	struct async_resp_arg *resp_arg = arg;
 	httpd_handle_t hd = resp_arg->hd;
 	int fd = resp_arg->fd;
-	// char response[200];
-	cJSON *json = cJSON_CreateObject();
-	cJSON_AddNumberToObject(json, "humidity", get_humidity());
-	cJSON_AddNumberToObject(json, "temperature", get_temperature());
-	// cJSON_AddStringToObject(json, "accel", get_accel());
-	// cJSON_AddStringToObject(json, "gyro", get_gyro());
-	// cJSON_AddNumberToObject(json, "lux", get_lux());
-	// cJSON_AddNumberToObject(json, "second", time_data[0]);
-	// cJSON_AddNumberToObject(json, "minute", time_data[1]);
-	// cJSON_AddNumberToObject(json, "hour", time_data[2]);
-	// cJSON_AddNumberToObject(json, "day", time_data[3]);
-	// cJSON_AddNumberToObject(json, "date", time_data[4]);
-	// cJSON_AddNumberToObject(json, "month", time_data[5]);
-	// cJSON_AddNumberToObject(json, "year", time_data[6]);
-
-	char *response = cJSON_Print(json);
-
-	cJSON_Delete(json);
+	// log viewers share the websocket slots but not the telemetry
+	if (ws_clients_kind(fd) != WS_KIND_DASHBOARD) {
+		resp_return(resp_arg);
+		return;
+	}
+	const payload_t *payload = payload_latest();
 
 	httpd_ws_frame_t ws_pkt={};
 	// memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-	ws_pkt.payload = (uint8_t *)response;
-	ws_pkt.len = strlen(response);
+	ws_pkt.payload = (uint8_t *)payload->json;
+	ws_pkt.len = payload->len;
 	ws_pkt.type = HTTPD_WS_TYPE_TEXT;
 
+	int64_t start_us = esp_timer_get_time();
+	TRACE_BEGIN("ws send");
 	httpd_ws_send_frame_async(hd, fd, &ws_pkt);
-	free(resp_arg);
+	TRACE_END("ws send");
+	perf_ws_send(esp_timer_get_time() - start_us);
+	perf_sample_sent(payload->stamp_us);
+	resp_return(resp_arg);
 }
 
+// Never returns: it is a static task from the task table, and a failed tick
+// only costs that tick's pushes.
 static void ws_server_send_messages(void *serverd) {
-    httpd_handle_t server = (httpd_handle_t)serverd;
-    bool send_messages = true;
-    while (send_messages) {
-        vTaskDelay(pdMS_TO_TICKS(10000)); // Fixed delay
-        if (server == NULL) { // Check handle directly
-            ESP_LOGE(TAG, "Server handle is NULL!");
-			   continue;
+	httpd_handle_t server = (httpd_handle_t)serverd;
+	const TickType_t period = pdMS_TO_TICKS(PUSH_PERIOD_MS);
+	TickType_t last_push = xTaskGetTickCount();
+	while (1) {
+		TickType_t since = xTaskGetTickCount() - last_push;
+		if (since < period)
+			ulTaskNotifyTake(pdTRUE, period - since);
+		// the pipeline wakes us for every published sample, capture mode pushes each one
+		bool fresh = false;
+		for (pipeline_event_t ev; pipeline_next(&ev);)
+			fresh = true;
+		if (xTaskGetTickCount() - last_push < period && !(capture && fresh))
+			continue;
+		last_push = xTaskGetTickCount();
+		// free heap around the tick's own work; anything else allocating at
+		// the same moment shows up too, so heap_changed is an upper bound
+		size_t heap_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+		sensor_snapshot_t snap;
+		snapshot_read(&snap);
+		backlog_push(&snap);
+		sse_publish();
+
+		size_t clients = CONFIG_SERVER_MAX_OPEN_SOCKETS;
+		int client_fds[CONFIG_SERVER_MAX_OPEN_SOCKETS];
+		if (httpd_get_client_list(server, &clients, client_fds) != ESP_OK) {
+			ESP_LOGE(TAG, "httpd_get_client_list failed, skipping this push");
+			continue;
 		}
-		int max_clients = 10;
-
-		size_t clients = max_clients;
-		int client_fds[max_clients];
-		if (httpd_get_client_list(server, &clients, client_fds) == ESP_OK) {
-			for (size_t i = 0; i < clients; ++i) {
-				int sock = client_fds[i];
-				if (httpd_ws_get_fd_info(server, sock) == HTTPD_WS_CLIENT_WEBSOCKET) {
-					ESP_LOGI(TAG, "Active client (fd=%d) -> sending async message", sock);
-					struct async_resp_arg *resp_arg = malloc(sizeof(struct async_resp_arg));
-					resp_arg->hd = server;
-					resp_arg->fd = sock;
-					if (httpd_queue_work(resp_arg->hd, send_data, resp_arg) != ESP_OK) {
-						ESP_LOGE(TAG, "httpd_queue_work failed!");
-						send_messages = false;
-						break;
-					}
-				}
+		for (size_t i = 0; i < clients; ++i) {
+			int sock = client_fds[i];
+			if (httpd_ws_get_fd_info(server, sock) != HTTPD_WS_CLIENT_WEBSOCKET)
+				continue;
+			struct async_resp_arg *resp_arg = resp_borrow();
+			if (resp_arg == NULL) {
+				// last tick's sends are still queued, this client skips one
+				push_stats.skipped++;
+				continue;
+			}
+			resp_arg->hd = server;
+			resp_arg->fd = sock;
+			if (httpd_queue_work(resp_arg->hd, send_data, resp_arg) != ESP_OK) {
+				// the work queue is full, the other clients would fail the same way
+				resp_return(resp_arg);
+				push_stats.queue_failed++;
+				ESP_LOGE(TAG, "httpd_queue_work failed, skipping the rest of this push");
+				break;
 			}
-		} else {
-		vTaskDelay(pdMS_TO_TICKS(500));
-			ESP_LOGE(TAG, "httpd_get_client_list failed!");
-			return;
+		}
+		int32_t delta = (int32_t)(heap_caps_get_free_size(MALLOC_CAP_8BIT) - heap_before);
+		push_stats.ticks++;
+		if (delta) {
+			push_stats.heap_changed++;
+			push_stats.last_heap_delta = delta;
 		}
 	}
 }
 
+void server_push_stats(server_push_stats_t *out) { *out = push_stats; }
+
 // setup for the server
 void server_init() {
 	httpd_handle_t httpd_handler = NULL;
 	httpd_config_t httpd_config = HTTPD_DEFAULT_CONFIG();
+	httpd_config.uri_match_fn = httpd_uri_match_wildcard;
+	httpd_config.max_open_sockets = CONFIG_SERVER_MAX_OPEN_SOCKETS;
+	httpd_config.max_uri_handlers = 16;
+	httpd_config.lru_purge_enable = true;
+	httpd_config.close_fn = ws_clients_close_fn;
+	// networking stays on core 0, core 1 belongs to acquisition (tasks.h)
+	httpd_config.core_id = 0;
 	httpd_start(&httpd_handler, &httpd_config);
+	workers_init();
 	httpd_uri_t httpd_uri = {
 		.uri = "/",
 		.method = HTTP_GET,
@@ -126,9 +274,51 @@ void server_init() {
 		.method = HTTP_GET,
 		.handler = ws_handler,
 		.is_websocket = true,
+		.handle_ws_control_frames = true,
 	};
 	httpd_register_uri_handler(httpd_handler, &ws_uri);
-	xTaskCreate(ws_server_send_messages, "send ws", 6000, httpd_handler,4, NULL);
+	httpd_uri_t jitter_uri = {
+		.uri = "/debug/jitter",
+		.method = HTTP_GET,
+		.handler = uri_jitter,
+	};
+	httpd_register_uri_handler(httpd_handler, &jitter_uri);
+	httpd_uri_t latest_uri = {
+		.uri = "/api/latest",
+		.method = HTTP_GET,
+		.handler = uri_latest,
+	};
+	httpd_register_uri_handler(httpd_handler, &latest_uri);
+	sse_init(httpd_handler);
+	export_init(httpd_handler);
+	metrics_init(httpd_handler);
+	perf_init(httpd_handler);
+	log_stream_init(httpd_handler);
+	trace_http_init(httpd_handler);
+	// catch-all, has to stay the last one registered
+	httpd_uri_t static_uri = {
+		.uri = "/*",
+		.method = HTTP_GET,
+		.handler = uri_static,
+	};
+	httpd_register_uri_handler(httpd_handler, &static_uri);
+	pusher = tasks_start(TASK_PUSHER, ws_server_send_messages, httpd_handler);
+	pipeline_set_consumer(pusher);
+
+	esp_timer_handle_t keepalive;
+	esp_timer_create_args_t keepalive_args = {
+		.callback = ws_keepalive_timer,
+		.arg = httpd_handler,
+		.name = "ws keepalive",
+	};
+	esp_timer_create(&keepalive_args, &keepalive);
+	esp_timer_start_periodic(keepalive, (uint64_t)CONFIG_SERVER_WS_PING_INTERVAL_S * 1000000);
+}
+
+void server_capture(bool on) {
+	capture = on;
+	if (pusher)
+		xTaskNotifyGive(pusher);
 }
 
 void mdns_service() {
@@ -1,9 +1,22 @@
 #ifndef SERVER_H
 #define SERVER_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
-extern uint8_t time_data[7];
 void mdns_service();
 void server_init();
+// capture mode pushes every new sample to the websockets, not one per 10s
+void server_capture(bool on);
+
+typedef struct {
+	uint32_t ticks;
+	uint32_t heap_changed;    // ticks where the free heap moved during the push
+	int32_t last_heap_delta;  // bytes, + means more free afterwards
+	uint32_t skipped;         // sends skipped for want of a free descriptor
+	uint32_t queue_failed;    // ticks cut short by a full httpd work queue
+} server_push_stats_t;
+
+// steady-state pushes should leave heap_changed at 0, see /debug/perf
+void server_push_stats(server_push_stats_t *out);
 #endif
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "backlog.h"
+#include "payload.h"
+#include "sse.h"
+#include "tasks.h"
+
+#define MAX_CLIENTS CONFIG_SERVER_SSE_MAX_CLIENTS
+#define KEEPALIVE_MS 15000
+
+#define NOTIFY_TICK BIT0
+#define NOTIFY_CLIENT BIT1
+
+static const char *TAG = "SSE";
+
+typedef struct {
+	httpd_req_t *req;  // async copy, owned by the stream task
+	uint32_t last_id;
+} stream_t;
+
+static stream_t streams[MAX_CLIENTS];
+static QueueHandle_t pending;
+static TaskHandle_t stream_task;
+static char event[PAYLOAD_MAX + 32];
+
+static void stream_close(stream_t *stream) {
+	httpd_req_async_handler_complete(stream->req);
+	stream->req = NULL;
+}
+
+// sends every backlog entry the client hasn't seen yet
+static void stream_catch_up(stream_t *stream) {
+	backlog_entry_t entry;
+	while (stream->req && backlog_next(stream->last_id, &entry)) {
+		int len = snprintf(event, sizeof(event), "id: %lu\ndata: ", (unsigned long)entry.id);
+		len += payload_format(&entry.snap, event + len, sizeof(event) - len - 2);
+		event[len++] = '\n';
+		event[len++] = '\n';
+		if (httpd_resp_send_chunk(stream->req, event, len) != ESP_OK) {
+			stream_close(stream);
+			return;
+		}
+		stream->last_id = entry.id;
+	}
+}
+
+static void stream_loop(void *arg) {
+	while (1) {
+		uint32_t bits = 0;
+		bool idle = xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(KEEPALIVE_MS)) == pdFALSE;
+
+		stream_t incoming;
+		while (xQueueReceive(pending, &incoming, 0) == pdTRUE) {
+			stream_t *slot = NULL;
+			for (size_t i = 0; i < MAX_CLIENTS && !slot; i++) {
+				if (streams[i].req == NULL)
+					slot = &streams[i];
+			}
+			if (slot == NULL) {
+				httpd_resp_send_chunk(incoming.req, "retry: 10000\n\n", HTTPD_RESP_USE_STRLEN);
+				httpd_resp_send_chunk(incoming.req, NULL, 0);
+				httpd_req_async_handler_complete(incoming.req);
+				continue;
+			}
+			*slot = incoming;
+		}
+
+		for (size_t i = 0; i < MAX_CLIENTS; i++) {
+			if (streams[i].req == NULL)
+				continue;
+			if (idle && httpd_resp_send_chunk(streams[i].req, ": keepalive\n\n", HTTPD_RESP_USE_STRLEN) != ESP_OK)
+				stream_close(&streams[i]);
+			stream_catch_up(&streams[i]);
+		}
+	}
+}
+
+static esp_err_t uri_stream(httpd_req_t *req) {
+	stream_t stream = {};
+	char last_event_id[12];
+	if (httpd_req_get_hdr_value_str(req, "Last-Event-ID", last_event_id, sizeof(last_event_id)) == ESP_OK) {
+		stream.last_id = strtoul(last_event_id, NULL, 10);
+		// ids restart with the device, a newer id than ours means we rebooted
+		if (stream.last_id > backlog_last_id())
+			stream.last_id = 0;
+	} else {
+		// fresh client: start with the newest tick instead of waiting for the next
+		uint32_t last = backlog_last_id();
+		stream.last_id = last ? last - 1 : 0;
+	}
+
+	httpd_resp_set_type(req, "text/event-stream");
+	httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+	if (httpd_resp_send_chunk(req, "retry: 3000\n\n", HTTPD_RESP_USE_STRLEN) != ESP_OK)
+		return ESP_FAIL;
+
+	// hand the socket to the stream task, the httpd worker is free again
+	if (httpd_req_async_handler_begin(req, &stream.req) != ESP_OK)
+		return ESP_FAIL;
+	if (xQueueSend(pending, &stream, 0) != pdTRUE) {
+		httpd_req_async_handler_complete(stream.req);
+		return ESP_OK;
+	}
+	xTaskNotify(stream_task, NOTIFY_CLIENT, eSetBits);
+	return ESP_OK;
+}
+
+void sse_publish() {
+	if (stream_task)
+		xTaskNotify(stream_task, NOTIFY_TICK, eSetBits);
+}
+
+void sse_init(httpd_handle_t server) {
+	pending = xQueueCreate(MAX_CLIENTS, sizeof(stream_t));
+	stream_task = tasks_start(TASK_SSE, stream_loop, NULL);
+
+	httpd_uri_t stream_uri = {
+		.uri = "/api/stream",
+		.method = HTTP_GET,
+		.handler = uri_stream,
+	};
+	httpd_register_uri_handler(server, &stream_uri);
+	ESP_LOGI(TAG, "streaming on /api/stream");
+}
@@ -0,0 +1,11 @@
+#ifndef SSE_H
+#define SSE_H
+
+#include "esp_http_server.h"
+
+// registers /api/stream and starts the task that owns the open streams
+void sse_init(httpd_handle_t server);
+// a new tick is in the backlog, stream it to every client
+void sse_publish();
+
+#endif
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "trace.h"
+
+#include "resp_writer.h"
+#include "trace_http.h"
+#include "workers.h"
+
+#define MAX_MS 10000
+#define MAX_TASKS 32
+
+// only the capture that trace_start let through touches these
+static char buf[1024];
+static TaskStatus_t tasks[MAX_TASKS];
+
+static UBaseType_t task_id(void *handle, UBaseType_t count) {
+	for (UBaseType_t i = 0; i < count; i++) {
+		if (tasks[i].xHandle == handle)
+			return tasks[i].xTaskNumber;
+	}
+	return 0;
+}
+
+static esp_err_t trace_capture(httpd_req_t *req) {
+	char query[24];
+	char value[8];
+	int ms = 1000;
+	if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && httpd_query_key_value(query, "ms", value, sizeof(value)) == ESP_OK)
+		ms = atoi(value);
+	if (ms < 1 || ms > MAX_MS)
+		ms = ms < 1 ? 1 : MAX_MS;
+
+	esp_err_t err = trace_start(CONFIG_SERVER_TRACE_EVENTS);
+	if (err != ESP_OK) {
+		httpd_resp_set_status(req, err == ESP_ERR_NO_MEM ? "503 Service Unavailable" : "409 Conflict");
+		return httpd_resp_sendstr(req, err == ESP_ERR_NO_MEM ? "no memory for the trace buffers" : "a capture is already running");
+	}
+	vTaskDelay(pdMS_TO_TICKS(ms));
+	trace_stop();
+	UBaseType_t count = uxTaskGetSystemState(tasks, MAX_TASKS, NULL);
+
+	resp_writer_t w;
+	resp_writer_init(&w, req, buf, sizeof(buf));
+	httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+	httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.json\"");
+	resp_writer_printf(&w, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%lu},\"traceEvents\":[", (unsigned long)trace_dropped());
+	for (int core = 0; core < portNUM_PROCESSORS; core++) {
+		resp_writer_printf(&w, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"core %d\"}}", core ? "," : "", core, core);
+		// tasks that aren't pinned can show up on either core
+		for (UBaseType_t i = 0; i < count; i++)
+			resp_writer_printf(&w, ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", core,
+							   (unsigned)tasks[i].xTaskNumber, tasks[i].pcTaskName);
+	}
+	for (int core = 0; core < portNUM_PROCESSORS; core++) {
+		trace_event_t e;
+		for (size_t i = 0; i < trace_count(core); i++) {
+			if (!trace_get(core, i, &e))
+				continue;
+			resp_writer_printf(&w, ",{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":%d,\"tid\":%u%s}", e.name, e.phase, (long long)e.ts_us, core,
+							   (unsigned)task_id(e.task, count), e.phase == 'i' ? ",\"s\":\"t\"" : "");
+		}
+	}
+	resp_writer_printf(&w, "]}");
+	trace_release();
+	return resp_writer_finish(&w);
+}
+
+static esp_err_t uri_trace(httpd_req_t *req) { return workers_submit(req, trace_capture); }
+
+void trace_http_init(httpd_handle_t server) {
+	httpd_uri_t trace_uri = {
+		.uri = "/debug/trace",
+		.method = HTTP_GET,
+		.handler = uri_trace,
+	};
+	httpd_register_uri_handler(server, &trace_uri);
+}
@@ -0,0 +1,10 @@
+#ifndef TRACE_HTTP_H
+#define TRACE_HTTP_H
+
+#include "esp_http_server.h"
+
+// registers /debug/trace?ms=N: records N ms (default 1000, at most 10000)
+// and downloads it as Chrome trace JSON, one process per core
+void trace_http_init(httpd_handle_t server);
+
+#endif
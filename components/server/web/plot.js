@@ -0,0 +1,72 @@
+// Small canvas line plot written for the dashboard, it is not Chart.js.
+// It takes a Chart.js-shaped config (new LinePlot(ctx, {data}), plot.data,
+// plot.update()) and draws lines, a grid and a legend, nothing else; being
+// embedded it renders on networks without internet access.
+class LinePlot {
+	constructor(ctx, config) {
+		this.ctx = ctx;
+		this.canvas = ctx.canvas;
+		this.data = config.data;
+		this.options = config.options || {};
+		window.addEventListener('resize', () => this.update());
+		this.update();
+	}
+
+	update() {
+		const ctx = this.ctx, canvas = this.canvas;
+		const dpr = window.devicePixelRatio || 1;
+		const w = canvas.clientWidth || 600, h = Math.round(w / 2);
+		canvas.width = w * dpr;
+		canvas.height = h * dpr;
+		canvas.style.height = h + 'px';
+		ctx.setTransform(dpr, 0, 0, dpr, 0, 0);
+		ctx.clearRect(0, 0, w, h);
+
+		const pad = {left: 48, right: 12, top: 28, bottom: 24};
+		const labels = this.data.labels, n = labels.length;
+		const values = this.data.datasets.flatMap(d => d.data).filter(v => typeof v === 'number');
+		let min = Math.min(...values), max = Math.max(...values);
+		if (!values.length) {
+			min = 0;
+			max = 1;
+		} else if (min === max) {
+			min -= 1;
+			max += 1;
+		}
+		const x = i => pad.left + (n > 1 ? i * (w - pad.left - pad.right) / (n - 1) : 0);
+		const y = v => h - pad.bottom - (v - min) * (h - pad.top - pad.bottom) / (max - min);
+
+		ctx.font = '11px Arial, Helvetica, sans-serif';
+		ctx.lineWidth = 1;
+		for (let i = 0; i <= 4; i++) {
+			const v = min + (max - min) * i / 4;
+			ctx.strokeStyle = '#333333';
+			ctx.beginPath();
+			ctx.moveTo(pad.left, y(v));
+			ctx.lineTo(w - pad.right, y(v));
+			ctx.stroke();
+			ctx.fillStyle = '#bbbbbb';
+			ctx.fillText(v.toFixed(1), 4, y(v) + 4);
+		}
+		if (n) {
+			const last = String(labels[n - 1]);
+			ctx.fillText(String(labels[0]), pad.left, h - 6);
+			ctx.fillText(last, w - pad.right - ctx.measureText(last).width, h - 6);
+		}
+
+		let legend = pad.left;
+		for (const dataset of this.data.datasets) {
+			ctx.strokeStyle = dataset.borderColor;
+			ctx.lineWidth = 2;
+			ctx.beginPath();
+			dataset.data.forEach((v, i) => (i ? ctx.lineTo(x(i), y(v)) : ctx.moveTo(x(i), y(v))));
+			ctx.stroke();
+
+			ctx.fillStyle = dataset.borderColor;
+			ctx.fillRect(legend, 8, 12, 12);
+			ctx.fillStyle = '#bbbbbb';
+			ctx.fillText(dataset.label, legend + 16, 18);
+			legend += ctx.measureText(dataset.label).width + 36;
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "tasks.h"
+#include "workers.h"
+
+static const char *TAG = "WORKERS";
+
+typedef struct {
+	httpd_req_t *req;  // async copy, released by the worker
+	worker_fn_t fn;
+} job_t;
+
+static QueueHandle_t jobs;
+
+static void worker_loop(void *arg) {
+	job_t job;
+	while (1) {
+		xQueueReceive(jobs, &job, portMAX_DELAY);
+		if (job.fn(job.req) != ESP_OK)
+			ESP_LOGW(TAG, "%s aborted", job.req->uri);
+		httpd_req_async_handler_complete(job.req);
+	}
+}
+
+esp_err_t workers_submit(httpd_req_t *req, worker_fn_t fn) {
+	// only the httpd task submits, so a free spot can't vanish before the send
+	if (uxQueueSpacesAvailable(jobs) == 0) {
+		httpd_resp_set_status(req, "503 Service Unavailable");
+		httpd_resp_set_hdr(req, "Retry-After", "5");
+		return httpd_resp_sendstr(req, "busy");
+	}
+	job_t job = {.fn = fn};
+	if (httpd_req_async_handler_begin(req, &job.req) != ESP_OK)
+		return ESP_FAIL;
+	xQueueSend(jobs, &job, 0);
+	return ESP_OK;
+}
+
+void workers_init() {
+	jobs = xQueueCreate(CONFIG_SERVER_WORKER_QUEUE, sizeof(job_t));
+	for (int i = 0; i < CONFIG_SERVER_WORKERS; i++)
+		tasks_start(TASK_WORKER, worker_loop, NULL);
+}
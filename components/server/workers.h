@@ -0,0 +1,15 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include "esp_http_server.h"
+
+// Long responses (exports, dumps) run here instead of on the httpd task,
+// which stays free for the dashboard, websocket handshakes and queued work.
+typedef esp_err_t (*worker_fn_t)(httpd_req_t *req);
+
+void workers_init();
+// Takes the socket over from the httpd task and runs fn on a worker, which
+// releases it afterwards. Answers 503 itself when every worker is busy.
+esp_err_t workers_submit(httpd_req_t *req, worker_fn_t fn);
+
+#endif
@@ -0,0 +1,120 @@
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ws_clients.h"
+
+#define PONG_TIMEOUT_US ((int64_t)CONFIG_SERVER_WS_PONG_TIMEOUT_S * 1000000)
+
+_Static_assert(WS_CLIENTS_MAX > 0, "CONFIG_SERVER_API_RESERVED_SLOTS leaves no socket for websockets");
+
+static const char *TAG = "WS CLIENTS";
+
+typedef struct {
+	int fd;  // -1 when free
+	ws_kind_t kind;
+	int64_t last_seen_us;
+} ws_client_t;
+
+static ws_client_t clients[WS_CLIENTS_MAX] = {[0 ... WS_CLIENTS_MAX - 1] = {.fd = -1}};
+
+static ws_client_t *find(int fd) {
+	for (size_t i = 0; i < WS_CLIENTS_MAX; i++) {
+		if (clients[i].fd == fd)
+			return &clients[i];
+	}
+	return NULL;
+}
+
+esp_err_t ws_clients_admit(httpd_req_t *req, ws_kind_t kind) {
+	int fd = httpd_req_to_sockfd(req);
+	ws_client_t *client = find(fd);
+	if (client == NULL)
+		client = find(-1);
+	if (client == NULL) {
+		ESP_LOGW(TAG, "fd=%d refused, the remaining sockets are reserved", fd);
+		return ESP_FAIL;
+	}
+	client->fd = fd;
+	client->kind = kind;
+	client->last_seen_us = esp_timer_get_time();
+	return ESP_OK;
+}
+
+ws_kind_t ws_clients_kind(int fd) {
+	ws_client_t *client = find(fd);
+	return client ? client->kind : WS_KIND_NONE;
+}
+
+void ws_clients_touch(int fd) {
+	ws_client_t *client = find(fd);
+	if (client)
+		client->last_seen_us = esp_timer_get_time();
+}
+
+// reads and drops len payload bytes, size at a time through buf
+static esp_err_t discard(httpd_req_t *req, size_t len, uint8_t *buf, size_t size) {
+	int fd = httpd_req_to_sockfd(req);
+	while (len) {
+		int n = httpd_socket_recv(req->handle, fd, (char *)buf, len < size ? len : size, 0);
+		if (n <= 0)
+			return ESP_FAIL;
+		len -= n;
+	}
+	return ESP_OK;
+}
+
+esp_err_t ws_clients_recv(httpd_req_t *req, httpd_ws_frame_t *frame, uint8_t *buf, size_t size) {
+	*frame = (httpd_ws_frame_t){};
+	if (httpd_ws_recv_frame(req, frame, 0) != ESP_OK)
+		return ESP_FAIL;
+	if (frame->len > size) {
+		// control frames are at most 125 bytes, a bigger one is a broken peer
+		if (frame->type & 0x8)
+			return ESP_FAIL;
+		// an oversized message costs the sender an error, not the session
+		if (discard(req, frame->len, buf, size) != ESP_OK)
+			return ESP_FAIL;
+		ws_clients_touch(httpd_req_to_sockfd(req));
+		return ESP_ERR_INVALID_SIZE;
+	}
+	frame->payload = buf;
+	if (frame->len && httpd_ws_recv_frame(req, frame, frame->len) != ESP_OK)
+		return ESP_FAIL;
+	ws_clients_touch(httpd_req_to_sockfd(req));
+
+	switch (frame->type) {
+	case HTTPD_WS_TYPE_PING:
+		frame->type = HTTPD_WS_TYPE_PONG;
+		return httpd_ws_send_frame(req, frame);
+	case HTTPD_WS_TYPE_CLOSE:
+		frame->len = 0;
+		httpd_ws_send_frame(req, frame);
+		return ESP_FAIL;
+	default:
+		return ESP_OK;
+	}
+}
+
+void ws_clients_keepalive(httpd_handle_t server) {
+	int64_t now = esp_timer_get_time();
+	httpd_ws_frame_t ping = {.final = true, .type = HTTPD_WS_TYPE_PING};
+	for (size_t i = 0; i < WS_CLIENTS_MAX; i++) {
+		int fd = clients[i].fd;
+		if (fd < 0)
+			continue;
+		if (now - clients[i].last_seen_us > PONG_TIMEOUT_US || httpd_ws_send_frame_async(server, fd, &ping) != ESP_OK) {
+			ESP_LOGW(TAG, "fd=%d stopped answering, closing", fd);
+			clients[i].fd = -1;
+			httpd_sess_trigger_close(server, fd);
+		}
+	}
+}
+
+void ws_clients_close_fn(httpd_handle_t server, int fd) {
+	ws_client_t *client = find(fd);
+	if (client)
+		client->fd = -1;
+	close(fd);
+}
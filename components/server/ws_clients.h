@@ -0,0 +1,34 @@
+#ifndef WS_CLIENTS_H
+#define WS_CLIENTS_H
+
+#include <stddef.h>
+#include "esp_http_server.h"
+
+#define WS_CLIENTS_MAX (CONFIG_SERVER_MAX_OPEN_SOCKETS - CONFIG_SERVER_API_RESERVED_SLOTS)
+
+// Bookkeeping of the open websockets, all of it runs on the httpd task.
+
+typedef enum {
+	WS_KIND_NONE,
+	WS_KIND_DASHBOARD,  // /ws, gets the telemetry pushes
+	WS_KIND_LOG,        // /ws/log
+} ws_kind_t;
+
+// handshake of a new websocket: ESP_FAIL when only reserved slots are left
+esp_err_t ws_clients_admit(httpd_req_t *req, ws_kind_t kind);
+ws_kind_t ws_clients_kind(int fd);
+// any frame from the client, pongs included, proves it is alive
+void ws_clients_touch(int fd);
+// Reads one frame into buf for a handler registered with
+// handle_ws_control_frames, answering pings itself. ESP_FAIL means the
+// socket is done (close frame, error) and should be returned;
+// ESP_ERR_INVALID_SIZE that a data frame bigger than buf was read and
+// dropped, the socket stays open.
+esp_err_t ws_clients_recv(httpd_req_t *req, httpd_ws_frame_t *frame, uint8_t *buf, size_t size);
+// pings every client and closes the ones that stopped answering
+void ws_clients_keepalive(httpd_handle_t server);
+
+// httpd close_fn, closes fd
+void ws_clients_close_fn(httpd_handle_t server, int fd);
+
+#endif
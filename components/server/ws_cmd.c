@@ -0,0 +1,159 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "esp_log.h"
+
+#include "clock.h"
+#include "dht22.h"
+#include "snapshot.h"
+
+#include "backlog.h"
+#include "perf.h"
+#include "server.h"
+#include "ws_cmd.h"
+
+#define FRAME_MAX 1024
+
+static const char *TAG = "WS CMD";
+
+// httpd task only
+static char frame[FRAME_MAX];
+
+// sends frame[0..len) as the next fragment of one text message
+static esp_err_t send_fragment(httpd_handle_t hd, int fd, size_t len, bool *first, bool final) {
+	httpd_ws_frame_t pkt = {
+		.type = *first ? HTTPD_WS_TYPE_TEXT : HTTPD_WS_TYPE_CONTINUE,
+		.fragmented = !(*first && final),
+		.final = final,
+		.payload = (uint8_t *)frame,
+		.len = len,
+	};
+	*first = false;
+	return httpd_ws_send_frame_async(hd, fd, &pkt);
+}
+
+// printf behind buf[0..len), truncating at the end of buf; returns the new length
+static size_t append(char *buf, size_t size, size_t len, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+
+static size_t append(char *buf, size_t size, size_t len, const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(buf + len, size - len, fmt, args);
+	va_end(args);
+	if (n < 0)
+		return len;
+	return len + n < size ? len + n : size - 1;
+}
+
+// {"id":7,"backlog":{"probes":["dht0"],"rows":[[id,t_ms,h0,t0,...,lux],...]}}
+// t_ms is null until the clock is set, lux until the light sensor has read
+esp_err_t ws_send_backlog(httpd_handle_t hd, int fd, uint32_t after, int req_id) {
+	bool first = true;
+	size_t len = 0;
+	if (req_id >= 0)
+		len = append(frame, sizeof(frame), len, "{\"id\":%d,", req_id);
+	else
+		len = append(frame, sizeof(frame), len, "{");
+	len = append(frame, sizeof(frame), len, "\"backlog\":{\"probes\":[");
+	for (size_t i = 0; i < dht22_probe_count(); i++)
+		len = append(frame, sizeof(frame), len, "%s\"%s\"", i ? "," : "", dht22_probe_name(i));
+	len = append(frame, sizeof(frame), len, "],\"rows\":[");
+
+	backlog_entry_t entry = {.id = after};
+	bool first_row = true;
+	while (backlog_next(entry.id, &entry)) {
+		char row[48 + DHT22_MAX_PROBES * 14];
+		size_t n = append(row, sizeof(row), 0, "%s[%lu,", first_row ? "" : ",", (unsigned long)entry.id);
+		if (clock_is_set())
+			n = append(row, sizeof(row), n, "%lld", (long long)(clock_utc_us(entry.snap.stamp_us) / 1000));
+		else
+			n = append(row, sizeof(row), n, "null");
+		for (size_t i = 0; i < entry.snap.dht_count; i++)
+			n = append(row, sizeof(row), n, ",%.1f,%.1f", entry.snap.humidity[i], entry.snap.temperature[i]);
+		if (entry.snap.lux_stamp_us)
+			n = append(row, sizeof(row), n, ",%.0f]", entry.snap.lux);
+		else
+			n = append(row, sizeof(row), n, ",null]");
+		first_row = false;
+
+		if (len + n > sizeof(frame)) {
+			if (send_fragment(hd, fd, len, &first, false) != ESP_OK)
+				return ESP_FAIL;
+			len = 0;
+		}
+		memcpy(frame + len, row, n);
+		len += n;
+	}
+	if (len + 3 > sizeof(frame)) {
+		if (send_fragment(hd, fd, len, &first, false) != ESP_OK)
+			return ESP_FAIL;
+		len = 0;
+	}
+	memcpy(frame + len, "]}}", 3);
+	return send_fragment(hd, fd, len + 3, &first, true);
+}
+
+static esp_err_t reply(httpd_handle_t hd, int fd, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+static esp_err_t reply(httpd_handle_t hd, int fd, const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(frame, sizeof(frame), fmt, args);
+	va_end(args);
+	bool first = true;
+	return send_fragment(hd, fd, len < (int)sizeof(frame) ? len : sizeof(frame) - 1, &first, true);
+}
+
+esp_err_t ws_cmd_too_long(httpd_req_t *req, size_t max) {
+	return reply(req->handle, httpd_req_to_sockfd(req), "{\"error\":\"message too long\",\"max\":%u}", (unsigned)max);
+}
+
+esp_err_t ws_cmd_dispatch(httpd_req_t *req, const char *msg, size_t len) {
+	httpd_handle_t hd = req->handle;
+	int fd = httpd_req_to_sockfd(req);
+	cJSON *root = cJSON_ParseWithLength(msg, len);
+	if (root == NULL)
+		return reply(hd, fd, "{\"error\":\"bad json\"}");
+
+	cJSON *id_item = cJSON_GetObjectItem(root, "id");
+	int id = cJSON_IsNumber(id_item) ? id_item->valueint : 0;
+	const char *cmd = cJSON_GetStringValue(cJSON_GetObjectItem(root, "cmd"));
+	cJSON *arg;
+	esp_err_t err;
+
+	if (cmd == NULL) {
+		err = reply(hd, fd, "{\"id\":%d,\"error\":\"no cmd\"}", id);
+	} else if (strcmp(cmd, "period") == 0) {
+		arg = cJSON_GetObjectItem(root, "ms");
+		// range checked on the double, the cast is undefined beyond uint32_t
+		if (cJSON_IsNumber(arg) && arg->valuedouble >= DHT22_PERIOD_MIN_MS && arg->valuedouble <= DHT22_PERIOD_MAX_MS &&
+			dht22_set_period((uint32_t)arg->valuedouble) == ESP_OK)
+			err = reply(hd, fd, "{\"id\":%d,\"ok\":true,\"ms\":%lu}", id, (unsigned long)dht22_period_ms());
+		else
+			err = reply(hd, fd, "{\"id\":%d,\"error\":\"ms must be a number from %d to %d\"}", id, DHT22_PERIOD_MIN_MS,
+						DHT22_PERIOD_MAX_MS);
+	} else if (strcmp(cmd, "rendered") == 0) {
+		arg = cJSON_GetObjectItem(root, "stamp_us");
+		if (cJSON_IsNumber(arg) && arg->valuedouble > 0 && arg->valuedouble < (double)INT64_MAX)
+			perf_sample_rendered((int64_t)arg->valuedouble);
+		err = ESP_OK;
+	} else if (strcmp(cmd, "read") == 0) {
+		// the fresh sample comes with the next version, pushed right away in capture mode
+		err = reply(hd, fd, "{\"id\":%d,\"ok\":true,\"version\":%lu}", id, (unsigned long)snapshot_version());
+		dht22_read_now();
+	} else if (strcmp(cmd, "capture") == 0) {
+		server_capture(cJSON_IsTrue(cJSON_GetObjectItem(root, "on")));
+		err = reply(hd, fd, "{\"id\":%d,\"ok\":true}", id);
+	} else if (strcmp(cmd, "backlog") == 0) {
+		arg = cJSON_GetObjectItem(root, "after");
+		bool valid = cJSON_IsNumber(arg) && arg->valuedouble >= 0 && arg->valuedouble <= UINT32_MAX;
+		err = ws_send_backlog(hd, fd, valid ? (uint32_t)arg->valuedouble : 0, id);
+	} else {
+		ESP_LOGW(TAG, "unknown command %s", cmd);
+		err = reply(hd, fd, "{\"id\":%d,\"error\":\"unknown cmd\"}", id);
+	}
+	cJSON_Delete(root);
+	return err;
+}
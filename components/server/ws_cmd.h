@@ -0,0 +1,24 @@
+#ifndef WS_CMD_H
+#define WS_CMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+
+// Commands arrive as JSON text frames, {"id":7,"cmd":"...",...}, and every
+// reply carries the same id:
+//   period  {"ms":N}       DHT22 read period, 2000 to 3600000
+//   read    {}             read every DHT22 probe now
+//   capture {"on":bool}    push every new sample instead of every 10s
+//   backlog {"after":N}    backlog entries newer than id N
+//   rendered {"stamp_us":N} echo of a drawn sample, no reply
+// Runs on the httpd task, straight from ws_handler.
+esp_err_t ws_cmd_dispatch(httpd_req_t *req, const char *msg, size_t len);
+// error reply for a message over max bytes that was dropped unread
+esp_err_t ws_cmd_too_long(httpd_req_t *req, size_t max);
+
+// backlog after the given id as one message of compact rows, fragmented
+// when it doesn't fit one frame; req_id < 0 sends it unsolicited
+esp_err_t ws_send_backlog(httpd_handle_t hd, int fd, uint32_t after, int req_id);
+
+#endif
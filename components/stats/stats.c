@@ -0,0 +1,48 @@
+#include <string.h>
+
+#include "stats.h"
+
+#define SUB_COUNT (1u << STATS_SUB_BITS)
+
+static uint32_t bucket_of(uint32_t value) {
+    if (value < SUB_COUNT)
+        return value;
+    uint32_t msb = 31 - __builtin_clz(value);
+    if (msb >= STATS_MAX_BITS)
+        return STATS_HIST_BUCKETS - 1;
+    uint32_t shift = msb - STATS_SUB_BITS;
+    return ((shift + 1) << STATS_SUB_BITS) + ((value >> shift) & (SUB_COUNT - 1));
+}
+
+static uint32_t bucket_upper(uint32_t bucket) {
+    if (bucket < SUB_COUNT)
+        return bucket;
+    uint32_t shift = (bucket >> STATS_SUB_BITS) - 1;
+    uint32_t sub = bucket & (SUB_COUNT - 1);
+    return ((SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+void stats_hist_record(stats_hist_t *hist, uint32_t value) {
+    hist->bucket[bucket_of(value)]++;
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+void stats_hist_reset(stats_hist_t *hist) { memset(hist, 0, sizeof(*hist)); }
+
+uint32_t stats_hist_percentile(const stats_hist_t *hist, uint32_t permille) {
+    if (hist->count == 0)
+        return 0;
+    uint64_t target = ((uint64_t)hist->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < STATS_HIST_BUCKETS; i++) {
+        seen += hist->bucket[i];
+        if (seen >= target) {
+            uint32_t upper = bucket_upper(i);
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
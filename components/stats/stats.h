@@ -0,0 +1,25 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// Log-linear histogram: every power of two is split into 2^STATS_SUB_BITS
+// buckets, so a percentile is never off by more than 25%. Values are usually
+// microseconds, anything past 2^STATS_MAX_BITS lands in the last bucket.
+#define STATS_SUB_BITS 2
+#define STATS_MAX_BITS 24
+#define STATS_HIST_BUCKETS ((STATS_MAX_BITS - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t bucket[STATS_HIST_BUCKETS];
+} stats_hist_t;
+
+void stats_hist_record(stats_hist_t *hist, uint32_t value);
+void stats_hist_reset(stats_hist_t *hist);
+// permille: 500 for p50, 990 for p99; returns the upper bound of the bucket
+uint32_t stats_hist_percentile(const stats_hist_t *hist, uint32_t permille);
+
+#endif
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "tasks.h"
+
+static const char *TAG = "tasks";
+
+_Static_assert(TASKS_RAM_TOTAL <= CONFIG_TASKS_RAM_BUDGET, "task table is over CONFIG_TASKS_RAM_BUDGET");
+
+// xtensa stack frames are 16-byte aligned
+#define X(id, name, stack, prio, core, n)                                                                              \
+    static StackType_t id##_stacks[n][(stack) / sizeof(StackType_t)] __attribute__((aligned(16)));                  \
+    static StaticTask_t id##_tcbs[n];                                                                                  \
+    static TaskHandle_t id##_handles[n];
+TASKS_TABLE(X)
+#undef X
+
+typedef struct {
+    const char *name;
+    uint32_t stack;
+    UBaseType_t prio;
+    BaseType_t core;
+    uint8_t count;
+    uint8_t started;
+    StackType_t *stacks;
+    StaticTask_t *tcbs;
+    TaskHandle_t *handles;
+} task_def_t;
+
+static task_def_t table[TASK_COUNT] = {
+#define X(id, name, stack, prio, core, n) \
+    [TASK_##id] = {name, stack, prio, core, n, 0, (StackType_t *)id##_stacks, id##_tcbs, id##_handles},
+    TASKS_TABLE(X)
+#undef X
+};
+
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+TaskHandle_t tasks_start(task_id_t id, TaskFunction_t fn, void *arg) {
+    task_def_t *t = &table[id];
+    portENTER_CRITICAL(&lock);
+    uint8_t i = t->started < t->count ? t->started++ : t->count;
+    portEXIT_CRITICAL(&lock);
+    if (i == t->count) {
+        ESP_LOGE(TAG, "%s: all %u instances running", t->name, t->count);
+        return NULL;
+    }
+
+    char name[configMAX_TASK_NAME_LEN];
+    if (t->count > 1)
+        snprintf(name, sizeof(name), "%s%u", t->name, i);
+    else
+        snprintf(name, sizeof(name), "%s", t->name);
+    StackType_t *stack = t->stacks + i * (t->stack / sizeof(StackType_t));
+    t->handles[i] = xTaskCreateStaticPinnedToCore(fn, name, t->stack, arg, t->prio, stack, &t->tcbs[i], t->core);
+    return t->handles[i];
+}
+
+uint32_t tasks_stack_size(TaskHandle_t task) {
+    for (size_t id = 0; id < TASK_COUNT; id++)
+        for (uint8_t i = 0; i < table[id].started; i++)
+            if (table[id].handles[i] == task)
+                return table[id].stack;
+    return 0;
+}
+
+void tasks_check() {
+    ESP_LOGI(TAG, "table %u bytes of %d budgeted", (unsigned)TASKS_RAM_TOTAL, CONFIG_TASKS_RAM_BUDGET);
+    for (size_t id = 0; id < TASK_COUNT; id++) {
+        const task_def_t *t = &table[id];
+        for (uint8_t i = 0; i < t->started; i++) {
+            // the stack is in bytes on this port, so is the high-water mark
+            uint32_t free = uxTaskGetStackHighWaterMark(t->handles[i]);
+            uint32_t used = t->stack - free;
+            ESP_LOGI(TAG, "%-16s stack=%-5lu used=%-5lu free=%lu", pcTaskGetName(t->handles[i]), (unsigned long)t->stack,
+                     (unsigned long)used, (unsigned long)free);
+            if (free < t->stack / 8) {
+                ESP_LOGW(TAG, "%s has %lu bytes of headroom left", t->name, (unsigned long)free);
+            } else if (free > t->stack / 2) {
+                // a quarter over the peak, rounded up to 256
+                uint32_t suggest = (used + used / 4 + 255) & ~255u;
+                ESP_LOGI(TAG, "%s could shrink to %lu", t->name, (unsigned long)suggest);
+            }
+        }
+    }
+}
+
+static void check_timer(void *arg) { tasks_check(); }
+
+void tasks_check_after(uint32_t seconds) {
+    if (seconds == 0)
+        return;
+    esp_timer_handle_t timer;
+    esp_timer_create_args_t args = {
+        .callback = check_timer,
+        .name = "tasks check",
+    };
+    if (esp_timer_create(&args, &timer) == ESP_OK)
+        esp_timer_start_once(timer, (uint64_t)seconds * 1000000);
+}
@@ -0,0 +1,60 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TASKS_ANY_CORE tskNO_AFFINITY
+
+#if CONFIG_TSL2561
+#define TASKS_TSL2561 1
+#else
+#define TASKS_TSL2561 0
+#endif
+
+// Every firmware task, with its stack and TCB allocated statically in tasks.c.
+// Cores: acquisition and processing (pipeline.h) own core 1, everything that
+// talks to the network shares core 0 with Wi-Fi, lwIP and httpd, and the
+// housekeeping at priority 1 runs wherever there is idle time.
+// Priorities: acquisition (5) matches httpd so reads stay on time; the pusher,
+// sse and the workers (4) sit just below httpd so a busy one never delays
+// the request loop; the log pump (2) lets log batches wait for telemetry.
+// id, name, stack bytes, priority, core, instances
+#define TASKS_TABLE(X) \
+    X(DHT,        "dht_test",       4608, 5, 1,              1) \
+    X(TSL2561,    "tsl2561",        3072, 5, 1,              TASKS_TSL2561) \
+    X(PIPE_BENCH, "pipe bench",     2048, 5, 1,              CONFIG_PIPELINE_BENCH_HZ ? 1 : 0) \
+    X(PROCESS,    "process",        3072, 2, 1,              1) \
+    X(PUSHER,     "send ws",        6000, 4, 0,              1) \
+    X(SSE,        "sse",            4096, 4, 0,              1) \
+    X(WORKER,     "httpd w",        4096, 4, 0,              CONFIG_SERVER_WORKERS) \
+    X(LOG_PUMP,   "log pump",       2048, 2, 0,              1) \
+    X(OTA,        "ota",            8192, 2, 0,              1) \
+    X(RTC,        "rtc",            3072, 1, TASKS_ANY_CORE, 1) \
+    X(DLOG,       "dlog",           3072, 1, TASKS_ANY_CORE, 1) \
+    X(SAMPLER,    "sampler_report", 3072, 1, TASKS_ANY_CORE, CONFIG_SAMPLER_JITTER_REPORT_S ? 1 : 0) \
+    X(HEAPACCT,   "heapacct",       3072, 1, TASKS_ANY_CORE, CONFIG_HEAPACCT_REPORT_S ? 1 : 0)
+
+typedef enum {
+#define X(id, name, stack, prio, core, n) TASK_##id,
+    TASKS_TABLE(X)
+#undef X
+    TASK_COUNT,
+} task_id_t;
+
+// Stacks plus TCBs of the whole table, checked against CONFIG_TASKS_RAM_BUDGET.
+#define TASKS_RAM_ENTRY(id, name, stack, prio, core, n) +((stack) + sizeof(StaticTask_t)) * (n)
+#define TASKS_RAM_TOTAL (0 TASKS_TABLE(TASKS_RAM_ENTRY))
+
+// Starts the next instance of a table entry; entries with several instances
+// get the index appended to the name. Returns NULL once all are running.
+TaskHandle_t tasks_start(task_id_t id, TaskFunction_t fn, void *arg);
+// Table stack size of a running task, 0 for tasks created elsewhere
+uint32_t tasks_stack_size(TaskHandle_t task);
+// Logs used stack against the table for every started task
+void tasks_check();
+void tasks_check_after(uint32_t seconds);
+
+#endif
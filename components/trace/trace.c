@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <esp_attr.h>
+#include <esp_cpu.h>
+#include <esp_ipc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "trace.h"
+
+#define CORES portNUM_PROCESSORS
+#define CYCLES_PER_US CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+
+typedef struct {
+    uint32_t cycles;
+    const char *name;  // NULL until the slot is complete
+    void *task;
+    char phase;
+} raw_event_t;
+
+typedef struct {
+    raw_event_t *events;
+    size_t cap;
+    uint32_t head;
+    // the cycle counters of the two cores aren't in sync, each gets its own base
+    uint32_t base_cycles;
+    int64_t base_us;
+} core_buf_t;
+
+volatile bool trace_recording;
+static core_buf_t bufs[CORES];
+static bool capturing;
+
+// Interrupts stay masked for the whole record, so the core can't change
+// under it and no writer is left halfway once trace_stop has waited.
+void IRAM_ATTR trace_record(const char *name, char phase) {
+    UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+    core_buf_t *b = &bufs[esp_cpu_get_core_id()];
+    uint32_t i = __atomic_fetch_add(&b->head, 1, __ATOMIC_RELAXED);
+    if (trace_recording && i < b->cap) {
+        raw_event_t *e = &b->events[i];
+        e->cycles = esp_cpu_get_cycle_count();
+        e->task = xTaskGetCurrentTaskHandle();
+        e->phase = phase;
+        __atomic_store_n(&e->name, name, __ATOMIC_RELEASE);
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+}
+
+// runs on each core in turn
+static void calibrate(void *arg) {
+    core_buf_t *b = &bufs[esp_cpu_get_core_id()];
+    portDISABLE_INTERRUPTS();
+    b->base_us = esp_timer_get_time();
+    b->base_cycles = esp_cpu_get_cycle_count();
+    portENABLE_INTERRUPTS();
+}
+
+esp_err_t trace_start(size_t per_core) {
+    // claimed before anything is touched, two requests on different workers
+    // can't both get past this
+    if (__atomic_exchange_n(&capturing, true, __ATOMIC_ACQUIRE))
+        return ESP_ERR_INVALID_STATE;
+    for (int c = 0; c < CORES; c++) {
+        bufs[c] = (core_buf_t){.events = calloc(per_core, sizeof(raw_event_t)), .cap = per_core};
+        if (bufs[c].events == NULL) {
+            // also gives the claim back
+            trace_release();
+            return ESP_ERR_NO_MEM;
+        }
+        esp_ipc_call_blocking(c, calibrate, NULL);
+    }
+    trace_recording = true;
+    return ESP_OK;
+}
+
+void trace_stop() {
+    trace_recording = false;
+    // a record already past the check on the other core finishes within
+    // microseconds, one that starts later sees trace_recording false
+    vTaskDelay(2);
+}
+
+size_t trace_count(uint8_t core) {
+    if (core >= CORES)
+        return 0;
+    return bufs[core].head < bufs[core].cap ? bufs[core].head : bufs[core].cap;
+}
+
+bool trace_get(uint8_t core, size_t index, trace_event_t *out) {
+    if (index >= trace_count(core))
+        return false;
+    const core_buf_t *b = &bufs[core];
+    const raw_event_t *e = &b->events[index];
+    const char *name = __atomic_load_n(&e->name, __ATOMIC_ACQUIRE);
+    if (name == NULL)
+        return false;
+    *out = (trace_event_t){
+        .ts_us = b->base_us + (uint32_t)(e->cycles - b->base_cycles) / CYCLES_PER_US,
+        .name = name,
+        .task = e->task,
+        .core = core,
+        .phase = e->phase,
+    };
+    return true;
+}
+
+uint32_t trace_dropped() {
+    uint32_t dropped = 0;
+    for (int c = 0; c < CORES; c++) {
+        if (bufs[c].head > bufs[c].cap)
+            dropped += bufs[c].head - bufs[c].cap;
+    }
+    return dropped;
+}
+
+void trace_release() {
+    trace_recording = false;
+    for (int c = 0; c < CORES; c++) {
+        free(bufs[c].events);
+        bufs[c] = (core_buf_t){};
+    }
+    __atomic_store_n(&capturing, false, __ATOMIC_RELEASE);
+}
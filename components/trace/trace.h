@@ -0,0 +1,46 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Event recorder for short captures. While no capture runs a TRACE_* costs
+// one load and a branch; during one, each core appends to its own buffer
+// with interrupts masked for an add and a cycle counter read, ISRs included.
+// Names must be string literals.
+#define TRACE_BEGIN(name) trace_event(name, 'B')
+#define TRACE_END(name) trace_event(name, 'E')
+#define TRACE_INSTANT(name) trace_event(name, 'i')
+
+typedef struct {
+    int64_t ts_us;  // esp_timer time, comparable across cores
+    const char *name;
+    void *task;  // TaskHandle_t of the recording task, or the one an ISR interrupted
+    uint8_t core;
+    char phase;  // 'B', 'E' or 'i' as in the Chrome trace format
+} trace_event_t;
+
+extern volatile bool trace_recording;
+void trace_record(const char *name, char phase);
+
+static inline void trace_event(const char *name, char phase) {
+    if (__builtin_expect(trace_recording, 0))
+        trace_record(name, phase);
+}
+
+// allocates per_core events for each core and starts recording; one
+// capture at a time, and at most ~17s at 240MHz since the cycle counters wrap
+esp_err_t trace_start(size_t per_core);
+void trace_stop();
+// events of the stopped capture, per core in recording order
+size_t trace_count(uint8_t core);
+bool trace_get(uint8_t core, size_t index, trace_event_t *out);
+// events that didn't fit
+uint32_t trace_dropped();
+// frees the buffers, the capture is gone; only for the caller whose
+// trace_start returned ESP_OK
+void trace_release();
+
+#endif
@@ -7,24 +7,49 @@
 #include <i2c_rw.h>
 // #include <mqtt.h>
 #include <ntp.h>
+#include <clock.h>
 #include <server.h>
 #include <ota.h>
 #include <dht22.h>
+#include <tsl2561.h>
+#include <ds1307.h>
+#include <sampler.h>
+#include <pipeline.h>
+#include <dlog.h>
+#include <heapacct.h>
+#include <tasks.h>
+
+static const dht22_probe_t dht_probes[] = {
+    {.pin = GPIO_NUM_27, .name = "dht0"},
+};
 
 void app_main(void) {
+    dlog_init();
+    clock_init();
     wifi_init();
      vTaskDelay(pdMS_TO_TICKS(2000)); 
     //
-    // tsl2561_init();
     // mpu6050_init();
     // dht_init();
     //
-    // ntp_init();
-    // tinyRTC_init();
+    // the RTC seeds the clock before SNTP gets a chance to steer it
+    tinyRTC_init();
+    ntp_init();
 
     // mqtt_init();
     mdns_service(); 
 	// ota_start();
     server_init();
-	dht22_init();
+	sampler_anchor();
+	pipeline_init();
+	dht22_init(dht_probes, sizeof(dht_probes) / sizeof(dht_probes[0]));
+#if CONFIG_TSL2561
+	tsl2561_init();
+#endif
+	sampler_report_start(CONFIG_SAMPLER_JITTER_REPORT_S);
+	heapacct_report_start(CONFIG_HEAPACCT_REPORT_S);
+	tasks_check_after(CONFIG_TASKS_CHECK_S);
+#if CONFIG_DLOG_BENCH
+	dlog_bench(32);
+#endif
 }
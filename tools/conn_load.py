@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Concurrent connection load test.
+
+Opens --ws websocket clients (the dashboard) and keeps --http clients
+polling /api/latest, then reports how many websockets survived, how many
+frames they got and whether the API stayed reachable. With --ws above the
+configured websocket slots the extra handshakes should fail while the API
+keeps answering. Once the clients have connected and --settle seconds
+passed, the push counters of /debug/perf are read at the start and the end
+of the run: if any steady-state push moved the free heap by more than
+--heap-tolerance ticks, the script exits with status 1. It does the same
+when /debug/heap?check=1 reports a task allocating faster than
+CONFIG_HEAPACCT_RATE_BUDGET over the run.
+"""
+import argparse
+import base64
+import json
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+
+def ws_open(host):
+    sock = socket.create_connection((host, 80), timeout=5)
+    key = base64.b64encode(os.urandom(16)).decode()
+    sock.sendall((f"GET /ws HTTP/1.1\r\nHost: {host}\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                  f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n").encode())
+    head = b""
+    while b"\r\n\r\n" not in head:
+        chunk = sock.recv(1024)
+        if not chunk:
+            raise OSError("closed during handshake")
+        head += chunk
+    if b" 101 " not in head.split(b"\r\n", 1)[0]:
+        raise OSError("handshake refused")
+    return sock
+
+
+def recv_exact(sock, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise OSError("closed")
+        buf += chunk
+    return buf
+
+
+def ws_send(sock, opcode, payload=b""):
+    mask = os.urandom(4)
+    masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    sock.sendall(struct.pack("!BB", 0x80 | opcode, 0x80 | len(payload)) + mask + masked)
+
+
+def ws_client(host, stop, stats):
+    try:
+        sock = ws_open(host)
+    except OSError:
+        stats["refused"] += 1
+        return
+    stats["open"] += 1
+    sock.settimeout(1)
+    try:
+        while not stop.is_set():
+            try:
+                b0, b1 = recv_exact(sock, 2)
+            except socket.timeout:
+                continue
+            n = b1 & 0x7F
+            if n == 126:
+                n = struct.unpack("!H", recv_exact(sock, 2))[0]
+            elif n == 127:
+                n = struct.unpack("!Q", recv_exact(sock, 8))[0]
+            payload = recv_exact(sock, n)
+            opcode = b0 & 0x0F
+            if opcode == 0x9:
+                ws_send(sock, 0xA, payload)
+            elif opcode == 0x8:
+                raise OSError("closed by server")
+            else:
+                stats["frames"] += 1
+    except OSError:
+        stats["dropped"] += 1
+        stats["open"] -= 1
+    finally:
+        sock.close()
+
+
+def poller(url, stop, stats):
+    while not stop.is_set():
+        t0 = time.monotonic()
+        try:
+            urllib.request.urlopen(url, timeout=5).read()
+            stats["ok"] += 1
+            stats["lat"].append(time.monotonic() - t0)
+        except OSError:
+            stats["fail"] += 1
+        time.sleep(0.5)
+
+
+def push_stats(host):
+    with urllib.request.urlopen(f"http://{host}/debug/perf", timeout=5) as r:
+        return json.load(r)["push"]
+
+
+def heap_check(host):
+    """Rates since the previous call; the device answers 500 when one is over budget."""
+    try:
+        with urllib.request.urlopen(f"http://{host}/debug/heap?check=1", timeout=5) as r:
+            return json.load(r)
+    except urllib.error.HTTPError as e:
+        if e.code != 500:
+            raise
+        return json.load(e)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="device address, e.g. 192.168.0.57")
+    parser.add_argument("--ws", type=int, default=10)
+    parser.add_argument("--http", type=int, default=2)
+    parser.add_argument("--seconds", type=int, default=120)
+    parser.add_argument("--settle", type=int, default=15, help="seconds for the connects to finish allocating")
+    parser.add_argument("--heap-tolerance", type=int, default=0, help="push ticks allowed to move the free heap")
+    args = parser.parse_args()
+
+    ws = {"open": 0, "refused": 0, "dropped": 0, "frames": 0}
+    api = {"ok": 0, "fail": 0, "lat": []}
+    stop = threading.Event()
+    threads = [threading.Thread(target=ws_client, args=(args.host, stop, ws), daemon=True) for _ in range(args.ws)]
+    threads += [threading.Thread(target=poller, args=(f"http://{args.host}/api/latest", stop, api), daemon=True)
+                for _ in range(args.http)]
+    for t in threads:
+        t.start()
+        time.sleep(0.05)
+    time.sleep(args.settle)
+    push_start = push_stats(args.host)
+    # starts the rate window, the connects before it don't count
+    heap_check(args.host)
+    time.sleep(args.seconds)
+    push_end = push_stats(args.host)
+    heap = heap_check(args.host)
+    stop.set()
+    for t in threads:
+        t.join(timeout=3)
+
+    lat = sorted(api["lat"]) or [0]
+    print(f"{args.ws} websockets, {args.http} pollers, {args.seconds}s")
+    print(f"websockets: {ws['open']} alive, {ws['refused']} refused, {ws['dropped']} dropped, {ws['frames']} frames")
+    print(f"api: {api['ok']} ok, {api['fail']} failed, "
+          f"p50 {lat[len(lat) // 2] * 1000:.0f} ms, p99 {lat[len(lat) * 99 // 100] * 1000:.0f} ms")
+    push = {k: v - push_start[k] for k, v in push_end.items() if k != "last_heap_delta"}
+    print(f"pushes: {push['ticks']} ticks, {push['heap_changed']} moved the free heap "
+          f"(last by {push_end['last_heap_delta']} bytes), {push['skipped']} sends skipped, "
+          f"{push['queue_failed']} cut short")
+    busiest = sorted(heap["tasks"], key=lambda t: t["allocs_per_s"], reverse=True)[:3]
+    print("allocs/s: " + ", ".join(f"{t['name']} {t['allocs_per_s']}" for t in busiest))
+
+    failed = False
+    if push["ticks"] == 0:
+        print("FAIL: no push during the run, make --seconds longer than the push period")
+        failed = True
+    if push["heap_changed"] > args.heap_tolerance:
+        print("FAIL: steady-state pushes touched the heap, see /debug/heap for the allocating task")
+        failed = True
+    if heap["over_budget"]:
+        print("FAIL: a task allocated faster than CONFIG_HEAPACCT_RATE_BUDGET")
+        failed = True
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
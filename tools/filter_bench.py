@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Host benchmark of the signal filters, in ns per sample.
+
+Builds components/filter/filter.c with the host C compiler next to a small
+driver and times each filter alone and the full chain over a noisy signal
+with spikes. Numbers are for the host CPU; compare them with each other and
+between commits rather than reading them as device timings.
+"""
+import argparse
+import os
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+FILTER = os.path.join(ROOT, "components", "filter")
+
+DRIVER = r"""
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "filter.h"
+
+static fix_t signal[4096];
+
+static void run(const char *name, const filter_conf_t *conf, size_t count, long n) {
+    filter_chain_t chain;
+    filter_chain_init(&chain, conf, count);
+    volatile fix_t sink;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < n; i++)
+        sink = filter_chain_step(&chain, signal[i & 4095]);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    (void)sink;
+    double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    printf("%-12s %6.2f ns/sample\n", name, ns / n);
+}
+
+int main(int argc, char **argv) {
+    long n = atol(argv[1]);
+    srand(1);
+    for (int i = 0; i < 4096; i++)
+        signal[i] = FIX_FROM_INT(20) + rand() % FIX_ONE - FIX_ONE / 2 + (i % 97 == 0 ? FIX_FROM_INT(40) : 0);
+
+    const filter_conf_t median = {.kind = FILTER_MEDIAN, .window = 5};
+    const filter_conf_t ema = {.kind = FILTER_EMA, .shift = 3};
+    const filter_conf_t kalman = {.kind = FILTER_KALMAN, .kalman = {.q = FIX_ONE / 100, .r = FIX_ONE / 4}};
+    const filter_conf_t chain[] = {median, ema, kalman};
+    run("none", NULL, 0, n);
+    run("median5", &median, 1, n);
+    run("ema", &ema, 1, n);
+    run("kalman", &kalman, 1, n);
+    run("chain", chain, 3, n);
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--samples", type=int, default=20_000_000)
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--cflags", default="-O2")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        driver = os.path.join(tmp, "driver.c")
+        exe = os.path.join(tmp, "filter_bench")
+        with open(driver, "w") as f:
+            f.write(DRIVER)
+        subprocess.run([args.cc, *args.cflags.split(), "-I", FILTER, driver, os.path.join(FILTER, "filter.c"), "-o", exe],
+                       check=True)
+        subprocess.run([exe, str(args.samples)], check=True)
+
+
+if __name__ == "__main__":
+    main()
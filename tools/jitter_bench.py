@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Sampling jitter under network load.
+
+Hammers the dashboard with concurrent HTTP clients for a while, then reads
+/debug/jitter and prints p50/p99/max wake lateness per sampling channel.
+Run once with --clients 0 for the idle baseline.
+"""
+import argparse
+import json
+import threading
+import time
+import urllib.request
+
+
+def hammer(url, stop):
+    while not stop.is_set():
+        try:
+            urllib.request.urlopen(url, timeout=5).read()
+        except OSError:
+            time.sleep(0.1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="device address, e.g. 192.168.0.57")
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--seconds", type=int, default=60)
+    args = parser.parse_args()
+
+    base = f"http://{args.host}"
+    urllib.request.urlopen(base + "/debug/jitter?reset=1", timeout=5).read()
+    stop = threading.Event()
+    workers = [threading.Thread(target=hammer, args=(base + "/", stop), daemon=True) for _ in range(args.clients)]
+    for w in workers:
+        w.start()
+    time.sleep(args.seconds)
+    stop.set()
+    after = json.load(urllib.request.urlopen(base + "/debug/jitter", timeout=5))
+
+    print(f"{args.clients} clients, {args.seconds}s")
+    print(f"{'channel':<12}{'samples':>8}{'p50 us':>9}{'p99 us':>9}{'max us':>9}{'overruns':>10}")
+    for c in after:
+        print(f"{c['name']:<12}{c['count']:>8}{c['p50']:>9}{c['p99']:>9}{c['max']:>9}{c['overruns']:>10}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Host check of the TSL2561 integer lux engine.
+
+Builds components/sensors/src/tsl2561_lux.c with the host C compiler and
+sweeps channel counts over every package, gain and integration time:
+- the result must match the TAOS reference algorithm, ported below, bit
+  for bit (exit status 1 otherwise);
+- how far it strays from the datasheet's floating point formulas is reported;
+- ns per call is timed for the integer engine and the float formulas.
+"""
+import argparse
+import array
+import os
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+SENSORS = os.path.join(ROOT, "components", "sensors")
+
+MAX_COUNT = {0: 5047, 1: 37177, 2: 65535}
+PACKAGES = {"T": 0, "CS": 1}
+
+# TAOS reference constants, K (ratio knee), B, M per segment
+TAOS = {
+    "T": [(0x0040, 0x01f2, 0x01be), (0x0080, 0x0214, 0x02d1), (0x00c0, 0x023f, 0x037b), (0x0100, 0x0270, 0x03fe),
+          (0x0138, 0x016f, 0x01fc), (0x019a, 0x00d2, 0x00fb), (0x029a, 0x0018, 0x0012), (0x029a, 0x0000, 0x0000)],
+    "CS": [(0x0043, 0x0204, 0x01ad), (0x0085, 0x0228, 0x02c1), (0x00c8, 0x0253, 0x0363), (0x010a, 0x0282, 0x03df),
+           (0x014d, 0x0177, 0x01dd), (0x019a, 0x0101, 0x0127), (0x029a, 0x0037, 0x002b), (0x029a, 0x0000, 0x0000)],
+}
+
+# datasheet formulas: (upper ratio, a, b, c) -> lux = a*ch0 - b*ch0*ratio^1.4 (first) or a*ch0 - c*ch1
+DATASHEET = {
+    "T": [(0.50, 0.0304, 0.062, None), (0.61, 0.0224, None, 0.031), (0.80, 0.0128, None, 0.0153),
+          (1.30, 0.00146, None, 0.00112)],
+    "CS": [(0.52, 0.0315, 0.0593, None), (0.65, 0.0229, None, 0.0291), (0.80, 0.0157, None, 0.0180),
+           (1.30, 0.00338, None, 0.00260)],
+}
+
+
+def taos_lux(package, gain, integ, ch0, ch1):
+    """CalculateLux() from the TAOS datasheet, 32 bit unsigned arithmetic.
+
+    The only change: the reference checks its unsigned difference for < 0,
+    which never fires; like the firmware this clamps to 0 instead.
+    """
+    u32 = 0xFFFFFFFF
+    ch_scale = {0: 0x7517, 1: 0x0fe7}.get(integ, 1 << 10)
+    if gain == 0:
+        ch_scale <<= 4
+    channel0 = ((ch0 * ch_scale) & u32) >> 10
+    channel1 = ((ch1 * ch_scale) & u32) >> 10
+    ratio1 = ((channel1 << 10) & u32) // channel0 if channel0 else 0
+    ratio = (ratio1 + 1) >> 1
+    for k, b, m in TAOS[package]:
+        if ratio <= k:
+            break
+    else:
+        b, m = 0, 0
+    visible, infrared = (channel0 * b) & u32, (channel1 * m) & u32
+    if infrared >= visible:
+        return 0
+    return ((visible - infrared + (1 << 13)) & u32) >> 14
+
+
+def datasheet_lux(package, gain, integ, ch0, ch1):
+    """Lux from the datasheet formulas, and the scale to judge errors by.
+
+    Both channels nearly cancel close to the top ratio, so the error is taken
+    relative to the visible term (a * ch0) rather than to the result.
+    """
+    scale = {0: 322 / 11, 1: 322 / 81}.get(integ, 1.0) * (16 if gain == 0 else 1)
+    ch0, ch1 = ch0 * scale, ch1 * scale
+    if ch0 == 0:
+        return 0.0, 0.0
+    ratio = ch1 / ch0
+    for upper, a, b, c in DATASHEET[package]:
+        if ratio <= upper:
+            return max(0.0, a * ch0 - b * ch0 * ratio ** 1.4 if b else a * ch0 - c * ch1), a * ch0
+    return 0.0, 0.0
+
+
+DRIVER = r"""
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "tsl2561_lux.h"
+
+// the old firmware formula, CS package, for timing only
+static float float_lux(float ch0, float ch1) {
+    float value = ch1 / ch0;
+    if (0 < value && value <= .52f)
+        return 0.0315f * ch0 - 0.0593f * ch0 * powf(value, 1.4f);
+    if (value <= .65f)
+        return 0.0229f * ch0 - 0.0291f * ch1;
+    if (value <= .80f)
+        return 0.0157f * ch0 - 0.018f * ch1;
+    if (value <= 1.3f)
+        return 0.00338f * ch0 - 0.0026f * ch1;
+    return 0;
+}
+
+static double now_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    int package = atoi(argv[1]), gain = atoi(argv[2]), integ = atoi(argv[3]), step = atoi(argv[4]), max = atoi(argv[5]);
+    if (argc > 6) {
+        long n = atol(argv[6]);
+        volatile uint32_t sink = 0;
+        volatile float fsink = 0;
+        double t0 = now_ns();
+        for (long i = 0; i < n; i++)
+            sink += tsl2561_lux(package, 1000 + (i & 1023), 300 + (i & 511), gain, integ);
+        double t1 = now_ns();
+        for (long i = 0; i < n; i++)
+            fsink += float_lux(1000 + (i & 1023), 300 + (i & 511));
+        double t2 = now_ns();
+        printf("%.2f %.2f\n", (t1 - t0) / n, (t2 - t1) / n);
+        return 0;
+    }
+    for (int ch0 = 0; ch0 <= max; ch0 += step)
+        for (int ch1 = 0; ch1 <= max; ch1 += step) {
+            uint32_t lux = tsl2561_lux(package, ch0, ch1, gain, integ);
+            fwrite(&lux, sizeof(lux), 1, stdout);
+        }
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--step", type=int, default=61, help="count step of the sweep, 1 checks every pair")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--cflags", default="-O2")
+    parser.add_argument("--calls", type=int, default=5_000_000)
+    args = parser.parse_args()
+
+    failed = False
+    with tempfile.TemporaryDirectory() as tmp:
+        driver = os.path.join(tmp, "driver.c")
+        exe = os.path.join(tmp, "lux_check")
+        with open(driver, "w") as f:
+            f.write(DRIVER)
+        subprocess.run([args.cc, *args.cflags.split(), "-I", os.path.join(SENSORS, "include"), driver,
+                        os.path.join(SENSORS, "src", "tsl2561_lux.c"), "-lm", "-o", exe], check=True)
+
+        for package, pkg_id in PACKAGES.items():
+            for gain in (0, 1):
+                for integ in (0, 1, 2):
+                    top = MAX_COUNT[integ]
+                    out = subprocess.run([exe, str(pkg_id), str(gain), str(integ), str(args.step), str(top)],
+                                         check=True, capture_output=True).stdout
+                    got = array.array("I", out)
+                    mismatches, worst, i = 0, 0.0, 0
+                    for ch0 in range(0, top + 1, args.step):
+                        for ch1 in range(0, top + 1, args.step):
+                            if got[i] != taos_lux(package, gain, integ, ch0, ch1):
+                                mismatches += 1
+                            ref, visible = datasheet_lux(package, gain, integ, ch0, ch1)
+                            if visible >= 10:
+                                worst = max(worst, abs(got[i] - ref) / visible)
+                            i += 1
+                    failed |= mismatches > 0
+                    print(f"{package:<2} gain {'16x' if gain else '1x':<3} integ {integ}: {i} points, "
+                          f"{mismatches} differ from TAOS, datasheet formula differs by up to {worst * 100:.1f}% of the visible term")
+
+        t_int, t_float = subprocess.run([exe, "1", "1", "1", "1", "1", str(args.calls)], check=True,
+                                        capture_output=True, text=True).stdout.split()
+        print(f"integer engine {t_int} ns/call, float formula {t_float} ns/call (host)")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
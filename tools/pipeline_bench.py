@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Sampling jitter and pipeline throughput, idle and under network load.
+
+Needs firmware built with CONFIG_PIPELINE_BENCH_HZ set, which adds a
+synthetic "bench" channel to the acquisition stage. Each phase resets the
+device counters, runs for --seconds and reads /debug/jitter and /debug/perf:
+first with the network idle, then with --ws dashboards, --slow throttled
+exports and a tight /api/latest poller hitting core 0.
+"""
+import argparse
+import json
+import threading
+import time
+import urllib.request
+
+from conn_load import ws_client
+from stream_bench import slow_download
+
+
+def get(host, path):
+    return json.load(urllib.request.urlopen(f"http://{host}{path}", timeout=10))
+
+
+def hammer(host, stop):
+    while not stop.is_set():
+        try:
+            urllib.request.urlopen(f"http://{host}/api/latest", timeout=5).read()
+        except OSError:
+            time.sleep(0.1)
+
+
+def phase(host, seconds, load):
+    get(host, "/debug/jitter?reset=1")
+    get(host, "/debug/perf?reset=1")
+    start = get(host, "/debug/perf")["pipeline"]
+    t0 = time.monotonic()
+
+    stop = threading.Event()
+    for fn, args in load:
+        threading.Thread(target=fn, args=args + (stop,), daemon=True).start()
+    time.sleep(seconds)
+    stop.set()
+
+    elapsed = time.monotonic() - t0
+    jitter = {c["name"]: c for c in get(host, "/debug/jitter")}
+    end = get(host, "/debug/perf")["pipeline"]
+    return jitter, start, end, elapsed
+
+
+def report(name, jitter, start, end, elapsed):
+    rate = (end["processed"] - start["processed"]) / elapsed
+    print(f"{name}: {rate:.1f} samples/s, {end['dropped'] - start['dropped']} dropped, "
+          f"{end['events_dropped'] - start['events_dropped']} events dropped, "
+          f"latency p50 {end['latency_us']['p50']} us p99 {end['latency_us']['p99']} us")
+    for channel in jitter.values():
+        print(f"  {channel['name']:<10} jitter p50 {channel['p50']} us, p99 {channel['p99']} us, "
+              f"max {channel['max']} us, overruns {channel['overruns']}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="device address, e.g. 192.168.0.57")
+    parser.add_argument("--seconds", type=int, default=30)
+    parser.add_argument("--ws", type=int, default=4)
+    parser.add_argument("--slow", type=int, default=2)
+    args = parser.parse_args()
+
+    if "bench" not in {c["name"] for c in get(args.host, "/debug/jitter")}:
+        print("no bench channel, build with CONFIG_PIPELINE_BENCH_HZ > 0")
+
+    report("idle", *phase(args.host, args.seconds, []))
+
+    ws = {"open": 0, "refused": 0, "dropped": 0, "frames": 0}
+    load = [(lambda h, s: ws_client(h, s, ws), (args.host,)) for _ in range(args.ws)]
+    load += [(slow_download, (args.host,)) for _ in range(args.slow)]
+    load.append((hammer, (args.host,)))
+    report("loaded", *phase(args.host, args.seconds, load))
+    print(f"  load: {ws['open']} websockets alive, {ws['refused']} refused, {ws['frames']} frames")
+
+
+if __name__ == "__main__":
+    main()
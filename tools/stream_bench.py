@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Short request latency next to slow long downloads.
+
+Starts --slow clients that fetch /api/export through a tiny receive window
+and read it a few bytes at a time, so the device blocks on every send, and
+meanwhile times GET /api/latest. Run once with --slow 0 for the baseline.
+"""
+import argparse
+import socket
+import threading
+import time
+import urllib.request
+
+
+def slow_download(host, stop):
+    while not stop.is_set():
+        sock = socket.socket()
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1024)
+        try:
+            sock.connect((host, 80))
+            sock.sendall(f"GET /api/export HTTP/1.1\r\nHost: {host}\r\n\r\n".encode())
+            while not stop.is_set() and sock.recv(16):
+                time.sleep(0.2)
+        except OSError:
+            time.sleep(0.5)
+        finally:
+            sock.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="device address, e.g. 192.168.0.57")
+    parser.add_argument("--slow", type=int, default=2)
+    parser.add_argument("--requests", type=int, default=100)
+    args = parser.parse_args()
+
+    stop = threading.Event()
+    for _ in range(args.slow):
+        threading.Thread(target=slow_download, args=(args.host, stop), daemon=True).start()
+    time.sleep(2)
+
+    lat, failed = [], 0
+    for _ in range(args.requests):
+        t0 = time.monotonic()
+        try:
+            urllib.request.urlopen(f"http://{args.host}/api/latest", timeout=10).read()
+            lat.append(time.monotonic() - t0)
+        except OSError:
+            failed += 1
+        time.sleep(0.1)
+    stop.set()
+
+    lat = sorted(lat) or [0]
+    print(f"{args.slow} slow downloads, {args.requests} requests, {failed} failed")
+    print(f"/api/latest p50 {lat[len(lat) // 2] * 1000:.0f} ms, p99 {lat[len(lat) * 99 // 100] * 1000:.0f} ms, "
+          f"max {lat[-1] * 1000:.0f} ms")
+
+
+if __name__ == "__main__":
+    main()